@@ -0,0 +1,110 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mcp_can.h>
+#include <SPI.h>
+#include <IDriveDecoder.h>
+#include <IDriveEventQueue.h>
+
+// decodes in the interrupt handler of the MCP2515, loop() only prints what
+// the handler queued. Nothing is lost while loop() is busy printing as long
+// as the queue does not fill up.
+
+// CAN RX Variables, used in the interrupt handler only
+long unsigned int rxId;
+unsigned char len;
+unsigned char rxBuf[8];
+
+// CAN0 INT and CS
+#define CAN0_INT 2                              // Set INT to pin 2, it has to be an interrupt pin
+MCP_CAN CAN0(10);                               // Set CS to pin 10
+
+typedef IDriveEventQueue<32> EventQueue;
+EventQueue events;
+
+BasicIDriveDecoder<EventQueue&, EventQueue&> IDrive(events, events);
+
+// the event names are the input followed by the kind of event
+const char *const inputNames[] = { "CENTER", "LEFT", "UP", "RIGHT", "DOWN", "MEDIA", "MENU", "MAP", "COM", "NAV", "BACK", "OPTION" };
+const char *const kindNames[] = { "", " Long", " Release" };
+
+unsigned char lastDropped = 0;
+
+void onCanInterrupt()
+{
+  // empty the MCP2515, it raises INT again for the next message only
+  while(!digitalRead(CAN0_INT))
+  {
+    CAN0.readMsgBuf(&rxId, &len, rxBuf);
+    if (rxId == 0x25B)
+    {
+      IDrive.decode(rxBuf);
+    }
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  
+  // Initialize MCP2515 running at 8MHz with a baudrate of 500kb/s and the masks and filters disabled.
+  if(CAN0.begin(MCP_ANY, CAN_500KBPS, MCP_8MHZ) == CAN_OK)
+    Serial.println("MCP2515 Initialized Successfully!");
+  else
+    Serial.println("Error Initializing MCP2515...");
+  
+  CAN0.setMode(MCP_NORMAL);
+
+  pinMode(CAN0_INT, INPUT);                           // Configuring pin for /INT input
+
+  SPI.usingInterrupt(digitalPinToInterrupt(CAN0_INT));
+  attachInterrupt(digitalPinToInterrupt(CAN0_INT), onCanInterrupt, FALLING);
+
+  // a message that arrived before attachInterrupt left INT low without an edge
+  noInterrupts();
+  onCanInterrupt();
+  interrupts();
+}
+
+void loop()
+{
+  IDriveEvent event;
+  while (events.pop(event))
+  {
+    if (event.eventId == IDRIVEDECODER_ROTARY)
+    {
+      Serial.print(event.value > 0 ? "CLOCKWISE: " : "COUNTERCLOCKWISE: ");
+      Serial.println(event.value);
+    }
+    else
+    {
+      Serial.print(inputNames[(event.eventId - 1) / 3]);
+      Serial.println(kindNames[(event.eventId - 1) % 3]);
+    }
+  }
+
+  // a single byte, the interrupt handler cannot change it halfway through the read
+  const unsigned char dropped = events.dropped;
+  if (dropped != lastDropped)
+  {
+    Serial.print("Dropped: ");
+    Serial.println(dropped);
+    lastDropped = dropped;
+  }
+}
@@ -0,0 +1,70 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mcp_can.h>
+#include <SPI.h>
+#include <IDriveDecoder.h>
+#include <IDriveEventStream.h>
+
+// sends the events as a binary stream instead of text, 1-4 bytes per event.
+// On the host: stty -F /dev/ttyACM0 115200 raw && idrive-stream /dev/ttyACM0
+
+// CAN RX Variables
+long unsigned int rxId;
+unsigned char len;
+unsigned char rxBuf[8];
+
+// CAN0 INT and CS
+#define CAN0_INT 6                              // Set INT to pin 6
+MCP_CAN CAN0(10);                               // Set CS to pin 10
+
+IDriveStreamEncoder stream;
+
+void send(const unsigned char eventId, const short value)
+{
+  unsigned char buffer[IDRIVESTREAM_MAX_BYTES];
+  Serial.write(buffer, stream.encode(eventId, value, millis(), buffer));
+}
+
+auto IDrive = makeIDriveDecoder(
+  [](unsigned char eventId) { send(eventId, 0); },
+  [](short rotary) { send(IDRIVEDECODER_ROTARY, rotary); });
+
+void setup()
+{
+  Serial.begin(115200);
+
+  // no text on the serial link, it would only show up as errors on the host
+  CAN0.begin(MCP_ANY, CAN_500KBPS, MCP_8MHZ);
+  CAN0.setMode(MCP_NORMAL);
+
+  pinMode(CAN0_INT, INPUT);                           // Configuring pin for /INT input
+}
+
+void loop()
+{
+  if(!digitalRead(CAN0_INT))
+  {
+    CAN0.readMsgBuf(&rxId, &len, rxBuf);
+    if (rxId == 0x25B)
+    {
+      IDrive.decode(rxBuf);
+    }
+  }
+}
@@ -0,0 +1,251 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* microbenchmark of IDriveDecoder on synthetic traffic:
+ *
+ *   idrive-bench [rounds]
+ *
+ * prints ns/frame and events/s of each traffic profile for the callback,
+ * mask and batch interfaces and for a decoder of the knob and menu only.
+ * Then the same for IDriveDecoderBank on the interleaved traffic of many
+ * controllers, and the throughput of IDriveEncoder.
+ */
+
+#include <IDriveDecoder.h>
+#include <IDriveDecoderBank.h>
+#include <IDriveEncoder.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const size_t frameCount = 1 << 16;
+static const size_t bankSlots  = 256;
+
+typedef std::vector<IDriveEventRecord> Records;
+
+struct Profile {
+  const char *name;
+  void (*generate)(uint8_t (*frames)[8], size_t n);
+};
+
+static void idle(uint8_t (*frames)[8], size_t n) {
+  IDriveEncoder encoder;
+  for (size_t i = 0; i < n; i++) {
+    encoder.encode(frames[i]);
+  }
+}
+
+static void rotary(uint8_t (*frames)[8], size_t n) {
+  IDriveEncoder encoder;
+  for (size_t i = 0; i < n; i++) {
+    encoder.rotate(1);
+    encoder.encode(frames[i]);
+  }
+}
+
+static void held(uint8_t (*frames)[8], size_t n) {
+  IDriveEncoder encoder;
+  encoder.apply(IDRIVEDECODER_MENU);
+  for (size_t i = 0; i < n; i++) {
+    encoder.encode(frames[i]);
+  }
+}
+
+// every input that can be held at the same time, the knob directions exclude each other
+static const unsigned char toggled[] = {
+  IDRIVEDECODER_CENTER, IDRIVEDECODER_LEFT, IDRIVEDECODER_MEDIA, IDRIVEDECODER_MENU, IDRIVEDECODER_MAP,
+  IDRIVEDECODER_COM,    IDRIVEDECODER_NAV,  IDRIVEDECODER_BACK,  IDRIVEDECODER_OPTION
+};
+
+static void toggling(uint8_t (*frames)[8], size_t n) {
+  IDriveEncoder encoder;
+  for (size_t i = 0; i < n; i++) {
+    for (size_t b = 0; b < sizeof(toggled); b++) {
+      encoder.apply(toggled[b] + (i & 1 ? 0 : 2));
+    }
+    encoder.encode(frames[i]);
+  }
+}
+
+static void counter(uint8_t (*frames)[8], size_t n) {
+  IDriveEncoder encoder;
+  encoder.apply(IDRIVEDECODER_MENU);
+  encoder.rotate(1);
+  for (size_t i = 0; i < n; i++) {
+    if (i % 256 == 0) {
+      encoder.restart();  // the decoder reports menu and the rotary again
+    }
+    encoder.encode(frames[i]);
+    if (i % 64 == 63) {
+      frames[i][0] -= 0x80;  // stale
+    }
+  }
+}
+
+static const Profile profiles[] = {
+  { "idle",     idle     },
+  { "rotary",   rotary   },
+  { "held",     held     },
+  { "toggling", toggling },
+  { "counter",  counter  },
+};
+
+static unsigned long callbackEvents;
+
+const void onSwitchEvent(const unsigned char&) {
+  callbackEvents++;
+}
+
+const void onRotaryEvent(const short&) {
+  callbackEvents++;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *profile, const char *api, double elapsed, unsigned long frames, unsigned long events) {
+  printf("%-10s %-10s %10.2f ns/frame %14.0f events/s\n", profile, api, elapsed * 1e9 / frames, events / elapsed);
+}
+
+static unsigned long countEvents(const IDriveEvents& events) {
+  return __builtin_popcountll(events.mask) + (events.rotary != 0);
+}
+
+int main(int argc, char **argv) {
+
+  const unsigned long rounds = argc > 1 ? strtoul(argv[1], 0, 0) : 200;
+
+  std::vector<uint8_t> buffer(frameCount * 8);
+  uint8_t (*frames)[8] = reinterpret_cast<uint8_t (*)[8]>(buffer.data());
+  Records records(frameCount * IDRIVEDECODER_MAX_EVENTS);
+
+  for (size_t p = 0; p < sizeof(profiles) / sizeof(profiles[0]); p++) {
+    const Profile &profile = profiles[p];
+    profile.generate(frames, frameCount);
+
+    const unsigned long total = rounds * frameCount;
+
+    {
+      IDriveDecoder decoder(onSwitchEvent, onRotaryEvent);
+      callbackEvents = 0;
+
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (unsigned long r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < frameCount; i++) {
+          decoder.decode(frames[i]);
+        }
+      }
+      report(profile.name, "callback", seconds(start), total, callbackEvents);
+    }
+
+    {
+      BasicIDriveDecoder<const void (&)(const unsigned char&), const void (&)(const short&), IDriveNoStats, IDriveNoTrace,
+        IDRIVEDECODER_INPUT_KNOB | IDRIVEDECODER_INPUT_MENU> decoder(onSwitchEvent, onRotaryEvent);
+      callbackEvents = 0;
+
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (unsigned long r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < frameCount; i++) {
+          decoder.decode(frames[i]);
+        }
+      }
+      report(profile.name, "knob+menu", seconds(start), total, callbackEvents);
+    }
+
+    {
+      IDriveDecoderCore decoder;
+      unsigned long count = 0;
+
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (unsigned long r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < frameCount; i++) {
+          IDriveEvents result;
+          decoder.decode(frames[i], result);
+          count += countEvents(result);
+        }
+      }
+      report(profile.name, "mask", seconds(start), total, count);
+    }
+
+    {
+      IDriveDecoderCore decoder;
+      unsigned long count = 0;
+
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (unsigned long r = 0; r < rounds; r++) {
+        IDriveEventSink sink = { records.data(), records.size(), 0 };
+        decoder.decodeBatch(frames, frameCount, sink);
+        count += sink.count;
+      }
+      report(profile.name, "batch", seconds(start), total, count);
+    }
+  }
+
+  {
+    // every controller turns its rotary, the messages arrive round-robin
+    std::vector<IDriveEncoder> encoders(bankSlots);
+    std::vector<uint32_t>      ids(frameCount);
+    IDriveDecoderBank<bankSlots> *bank = new IDriveDecoderBank<bankSlots>();
+
+    for (size_t i = 0; i < frameCount; i++) {
+      const size_t slot = i % bankSlots;
+      ids[i] = 0x100 + slot;
+      encoders[slot].rotate(1);
+      encoders[slot].encode(frames[i]);
+      bank->add(ids[i]);
+    }
+
+    unsigned long count = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned long r = 0; r < rounds; r++) {
+      IDriveEventSink sink = { records.data(), records.size(), 0 };
+      bank->decodeBatch(ids.data(), frames, frameCount, sink);
+      count += sink.count;
+    }
+    report("bank", "batch", seconds(start), rounds * frameCount, count);
+
+    delete bank;
+  }
+
+  {
+    const IDriveAction script[] = {
+      { IDRIVEDECODER_MENU,     0, 16 },
+      { IDRIVEDECODER_MENU_EXT, 1, 16 },
+      { IDRIVEDECODER_MENU_REL, 0, 32 },
+    };
+    IDriveEncoder encoder;
+    unsigned long total = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned long r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < frameCount; i += 64) {
+        total += encoder.encode(script, 3, frames + i, frameCount - i);
+      }
+    }
+    const double elapsed = seconds(start);
+    printf("%-10s %-10s %10.2f ns/frame %14.0f frames/s\n", "encoder", "script", elapsed * 1e9 / total, total / elapsed);
+  }
+
+  return 0;
+}
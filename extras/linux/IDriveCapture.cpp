@@ -0,0 +1,383 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveCapture.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char     headerMagic[8]  = "IDRVCAP";
+static const char     trailerMagic[8] = "IDRVIDX";
+static const uint32_t version         = 1;
+
+static void saveState(const IDriveDecoderCore& decoder, uint8_t (&state)[8]) {
+  IDriveDecoderState current;
+  decoder.saveState(current);
+
+  state[0] = current.counter;
+  state[1] = current.switches[0];
+  state[2] = current.switches[1];
+  state[3] = current.switches[2];
+  state[4] = current.pos;
+  state[5] = current.pos >> 8;
+  state[6] = current.version;
+  state[7] = 0;
+}
+
+static bool restoreState(IDriveDecoderCore& decoder, const uint8_t (&state)[8]) {
+  IDriveDecoderState saved;
+
+  saved.version     = state[6];
+  saved.reserved    = 0;
+  saved.counter     = state[0];
+  saved.switches[0] = state[1];
+  saved.switches[1] = state[2];
+  saved.switches[2] = state[3];
+  saved.pos         = state[4] | state[5] << 8;
+
+  return decoder.restoreState(saved);
+}
+
+IDriveCaptureWriter::IDriveCaptureWriter(const uint32_t blockRecords):blockRecords(blockRecords ? blockRecords : 1),file(0),last(0),frames(0) {
+  memset(&block, 0, sizeof(block));
+}
+
+IDriveCaptureWriter::~IDriveCaptureWriter() {
+  close();
+}
+
+bool IDriveCaptureWriter::open(const char* path) {
+
+  close();
+
+  file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+
+  IDriveCaptureHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, headerMagic, sizeof(header.magic));
+  header.version      = version;
+  header.blockRecords = blockRecords;
+
+  decoder = IDriveDecoderCore();
+  frames  = 0;
+  records.clear();
+  records.reserve(blockRecords);
+  index.clear();
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1) {
+    fclose(file);
+    file = 0;
+    return false;
+  }
+
+  return true;
+}
+
+bool IDriveCaptureWriter::write(const unsigned char* data, const uint64_t timestamp, const unsigned char flags) {
+
+  // deltas between whole us so that they add up to the exact timestamps
+  uint64_t delta = 0;
+
+  if (!records.empty()) {
+    delta = timestamp / 1000 > last / 1000 ? timestamp / 1000 - last / 1000 : 0;
+
+    if (records.size() == blockRecords || delta > UINT32_MAX) {
+      if (!flush()) {
+        return false;
+      }
+      delta = 0;
+    }
+  }
+
+  if (records.empty()) {
+    block.time  = timestamp;
+    block.frame = frames;
+    saveState(decoder, block.state);
+  }
+
+  IDriveCaptureRecord record;
+  memset(&record, 0, sizeof(record));
+  record.delta = delta;
+  memcpy(record.data, data, sizeof(record.data));
+  record.flags = flags;
+  records.push_back(record);
+
+  last = timestamp;
+  frames++;
+
+  IDriveEvents events;
+  decoder.decode(data, events);
+  return true;
+}
+
+bool IDriveCaptureWriter::flush(void) {
+
+  if (records.empty()) {
+    return true;
+  }
+
+  IDriveCaptureIndex entry;
+  entry.offset      = ftello(file);
+  entry.block       = block;
+  entry.block.count = records.size();
+
+  if (fwrite(&entry.block, sizeof(entry.block), 1, file) != 1
+      || fwrite(records.data(), sizeof(IDriveCaptureRecord), records.size(), file) != records.size()) {
+    return false;
+  }
+
+  index.push_back(entry);
+  records.clear();
+  return true;
+}
+
+bool IDriveCaptureWriter::close(void) {
+
+  if (!file) {
+    return true;
+  }
+
+  IDriveCaptureTrailer trailer;
+  memset(&trailer, 0, sizeof(trailer));
+  memcpy(trailer.magic, trailerMagic, sizeof(trailer.magic));
+
+  bool ok = flush();
+
+  trailer.indexOffset = ftello(file);
+  trailer.blocks      = index.size();
+  trailer.frames      = frames;
+
+  ok = ok
+    && fwrite(index.data(), sizeof(IDriveCaptureIndex), index.size(), file) == index.size()
+    && fwrite(&trailer, sizeof(trailer), 1, file) == 1;
+
+  ok = fclose(file) == 0 && ok;
+  file = 0;
+  return ok;
+}
+
+IDriveCaptureReader::IDriveCaptureReader():begin(0),end(0),frameCount(0),block(0),record(0),time(0) {
+}
+
+IDriveCaptureReader::~IDriveCaptureReader() {
+  close();
+}
+
+bool IDriveCaptureReader::open(const char* path) {
+
+  close();
+
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) < 0) {
+    ::close(fd);
+    return false;
+  }
+
+  if ((size_t)info.st_size < sizeof(IDriveCaptureHeader)) {
+    ::close(fd);
+    errno = EINVAL;
+    return false;
+  }
+
+  void *map = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  begin = static_cast<const uint8_t*>(map);
+  end   = begin + info.st_size;
+
+  const IDriveCaptureHeader *header = reinterpret_cast<const IDriveCaptureHeader*>(begin);
+  if (memcmp(header->magic, headerMagic, sizeof(header->magic)) || header->version != version) {
+    close();
+    errno = EINVAL;
+    return false;
+  }
+
+  if (!readIndex() && !scanBlocks()) {
+    close();
+    errno = EINVAL;
+    return false;
+  }
+
+  frameCount = 0;
+  for (size_t i = 0; i < index.size(); i++) {
+    frameCount += index[i].block.count;
+  }
+
+  block  = 0;
+  record = 0;
+  return true;
+}
+
+void IDriveCaptureReader::close(void) {
+  if (begin) {
+    munmap(const_cast<uint8_t*>(begin), end - begin);
+  }
+  begin = 0;
+  end   = 0;
+  index.clear();
+  frameCount = 0;
+}
+
+bool IDriveCaptureReader::readIndex(void) {
+
+  const size_t size = end - begin;
+
+  if (size < sizeof(IDriveCaptureHeader) + sizeof(IDriveCaptureTrailer)) {
+    return false;
+  }
+
+  IDriveCaptureTrailer trailer;
+  memcpy(&trailer, end - sizeof(trailer), sizeof(trailer));
+
+  if (memcmp(trailer.magic, trailerMagic, sizeof(trailer.magic))
+      || trailer.indexOffset < sizeof(IDriveCaptureHeader)
+      || trailer.indexOffset > size
+      || (size - sizeof(trailer) - trailer.indexOffset) != trailer.blocks * sizeof(IDriveCaptureIndex)) {
+    return false;
+  }
+
+  const IDriveCaptureIndex *entries = reinterpret_cast<const IDriveCaptureIndex*>(begin + trailer.indexOffset);
+  index.assign(entries, entries + trailer.blocks);
+
+  for (size_t i = 0; i < index.size(); i++) {
+    if (index[i].offset + sizeof(IDriveCaptureBlock) + (uint64_t)index[i].block.count * sizeof(IDriveCaptureRecord) > trailer.indexOffset) {
+      index.clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool IDriveCaptureReader::scanBlocks(void) {
+
+  uint64_t offset = sizeof(IDriveCaptureHeader);
+
+  index.clear();
+
+  // complete blocks only, a crashed writer may have left a partial one
+  while (offset + sizeof(IDriveCaptureBlock) <= (uint64_t)(end - begin)) {
+    IDriveCaptureIndex entry;
+    entry.offset = offset;
+    memcpy(&entry.block, begin + offset, sizeof(entry.block));
+
+    const uint64_t next = offset + sizeof(IDriveCaptureBlock) + (uint64_t)entry.block.count * sizeof(IDriveCaptureRecord);
+    if (!entry.block.count || next > (uint64_t)(end - begin)) {
+      break;
+    }
+
+    index.push_back(entry);
+    offset = next;
+  }
+
+  return true;
+}
+
+bool IDriveCaptureReader::next(const unsigned char*& data, uint64_t& timestamp, unsigned char& flags) {
+
+  while (block < index.size()) {
+    const IDriveCaptureIndex &entry = index[block];
+
+    if (record < entry.block.count) {
+      const IDriveCaptureRecord *records = reinterpret_cast<const IDriveCaptureRecord*>(begin + entry.offset + sizeof(IDriveCaptureBlock));
+      const IDriveCaptureRecord &current = records[record];
+
+      if (record == 0) {
+        time = entry.block.time / 1000;
+      }
+      time += current.delta;
+      record++;
+
+      data      = current.data;
+      timestamp = time * 1000;
+      flags     = current.flags;
+      return true;
+    }
+
+    block++;
+    record = 0;
+  }
+
+  return false;
+}
+
+static bool startsAfter(const uint64_t timestamp, const IDriveCaptureIndex& entry) {
+  return timestamp < entry.block.time;
+}
+
+bool IDriveCaptureReader::seek(const uint64_t timestamp, IDriveDecoderCore& decoder) {
+
+  // the last block starting at or before timestamp
+  std::vector<IDriveCaptureIndex>::const_iterator found = std::upper_bound(index.begin(), index.end(), timestamp, startsAfter);
+  if (found != index.begin()) {
+    --found;
+  }
+
+  block  = found - index.begin();
+  record = 0;
+
+  if (block == index.size()) {
+    return false;
+  }
+
+  if (!restoreState(decoder, index[block].block.state)) {
+    errno = EINVAL;
+    return false;
+  }
+
+  for (;;) {
+    const size_t   savedBlock  = block;
+    const uint32_t savedRecord = record;
+    const uint64_t savedTime   = time;
+
+    const unsigned char *data;
+    uint64_t             current;
+    unsigned char        flags;
+
+    if (!next(data, current, flags)) {
+      return false;
+    }
+
+    if (current >= timestamp) {
+      block  = savedBlock;
+      record = savedRecord;
+      time   = savedTime;
+      return true;
+    }
+
+    IDriveEvents events;
+    decoder.decode(data, events);
+  }
+}
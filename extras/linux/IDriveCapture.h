@@ -0,0 +1,147 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVECAPTURE_H_
+#define IDRIVECAPTURE_H_
+
+#include <IDriveDecoder.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/* binary capture of 0x25B CAN-messages (little-endian):
+ *
+ *   header   IDriveCaptureHeader
+ *   block    IDriveCaptureBlock followed by 'count' IDriveCaptureRecords
+ *   ...
+ *   index    one IDriveCaptureIndex per block
+ *   trailer  IDriveCaptureTrailer
+ *
+ * Every block starts with the decoder state before its first record, so
+ * decoding can start at any block without replaying what came before. A new
+ * block starts every blockRecords messages, or earlier when the time since
+ * the previous message does not fit a record. Timestamps have us resolution.
+ */
+
+struct IDriveCaptureHeader {
+  char     magic[8];        // "IDRVCAP"
+  uint32_t version;
+  uint32_t blockRecords;
+  uint64_t reserved[2];
+};
+
+struct IDriveCaptureRecord {
+  uint32_t delta;           // us since the previous record of the block, 0 for the first
+  uint8_t  data[8];
+  uint8_t  flags;           // passed through from IDriveCaptureWriter::write
+  uint8_t  reserved[3];
+};
+
+struct IDriveCaptureBlock {
+  uint64_t time;            // ns timestamp of the first record
+  uint64_t frame;           // index of the first record within the capture
+  uint32_t count;
+  uint8_t  state[8];        // decoder state before the first record: counter, switches[3], pos (low, high), version
+  uint32_t reserved;
+};
+
+struct IDriveCaptureIndex {
+  uint64_t           offset;  // of the IDriveCaptureBlock within the file
+  IDriveCaptureBlock block;
+};
+
+struct IDriveCaptureTrailer {
+  uint64_t indexOffset;
+  uint64_t blocks;
+  uint64_t frames;
+  char     magic[8];        // "IDRVIDX"
+};
+
+class IDriveCaptureWriter {
+public:
+
+  explicit IDriveCaptureWriter(const uint32_t blockRecords = 4096);
+  ~IDriveCaptureWriter();
+
+  /* all return false and leave errno set on failure */
+  bool open(const char* path);
+  bool write(const unsigned char* data, const uint64_t timestamp, const unsigned char flags = 0);
+  bool close(void);
+
+private:
+  const uint32_t                   blockRecords;
+  FILE                            *file;
+  IDriveDecoderCore                decoder;
+  IDriveCaptureBlock               block;
+  uint64_t                         last;
+  uint64_t                         frames;
+  std::vector<IDriveCaptureRecord> records;
+  std::vector<IDriveCaptureIndex>  index;
+
+  bool flush(void);
+
+  IDriveCaptureWriter(const IDriveCaptureWriter&);
+  IDriveCaptureWriter& operator=(const IDriveCaptureWriter&);
+};
+
+/* reads a capture through a read-only mapping, records are not copied */
+class IDriveCaptureReader {
+public:
+
+  IDriveCaptureReader();
+  ~IDriveCaptureReader();
+
+  /* returns false and leaves errno set on failure. A capture without index
+   * (writer did not close it) is indexed by walking its blocks. */
+  bool open(const char* path);
+  void close(void);
+
+  inline uint64_t frames(void) const {
+    return frameCount;
+  }
+
+  inline const std::vector<IDriveCaptureIndex>& blocks(void) const {
+    return index;
+  }
+
+  /* positions at the first message at or after timestamp and puts decoder
+   * into the state it had before that message */
+  bool seek(const uint64_t timestamp, IDriveDecoderCore& decoder);
+
+  /* the next message, data points into the mapping */
+  bool next(const unsigned char*& data, uint64_t& timestamp, unsigned char& flags);
+
+private:
+  const uint8_t                  *begin;
+  const uint8_t                  *end;
+  std::vector<IDriveCaptureIndex> index;
+  uint64_t                        frameCount;
+  size_t                          block;     // current position: index[block], record
+  uint32_t                        record;
+  uint64_t                        time;      // us of the current record
+
+  bool readIndex(void);
+  bool scanBlocks(void);
+
+  IDriveCaptureReader(const IDriveCaptureReader&);
+  IDriveCaptureReader& operator=(const IDriveCaptureReader&);
+};
+
+#endif /* IDRIVECAPTURE_H_ */
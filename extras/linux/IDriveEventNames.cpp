@@ -0,0 +1,42 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveEventNames.h"
+
+#include <IDriveDecoder.h>
+
+static const char *const names[IDRIVEDECODER_OPTION_REL + 1] = {
+  "ROTARY",
+  "CENTER", "CENTER Long", "CENTER Release",
+  "LEFT",   "LEFT Long",   "LEFT Release",
+  "UP",     "UP Long",     "UP Release",
+  "RIGHT",  "RIGHT Long",  "RIGHT Release",
+  "DOWN",   "DOWN Long",   "DOWN Release",
+  "MEDIA",  "MEDIA Long",  "MEDIA Release",
+  "MENU",   "MENU Long",   "MENU Release",
+  "MAP",    "MAP Long",    "MAP Release",
+  "COM",    "COM Long",    "COM Release",
+  "NAV",    "NAV Long",    "NAV Release",
+  "BACK",   "BACK Long",   "BACK Release",
+  "OPTION", "OPTION Long", "OPTION Release",
+};
+
+const char *idriveEventName(const unsigned char eventId) {
+  return eventId <= IDRIVEDECODER_OPTION_REL ? names[eventId] : 0;
+}
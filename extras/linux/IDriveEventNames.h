@@ -0,0 +1,27 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEEVENTNAMES_H_
+#define IDRIVEEVENTNAMES_H_
+
+/* "CENTER", "CENTER Long", "CENTER Release", ... for IDRIVEDECODER_*,
+ * "ROTARY" for IDRIVEDECODER_ROTARY and 0 for unknown ids */
+const char *idriveEventName(const unsigned char eventId);
+
+#endif /* IDRIVEEVENTNAMES_H_ */
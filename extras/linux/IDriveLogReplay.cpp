@@ -0,0 +1,265 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveLogReplay.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/* value of a hex digit, 0xff for anything else */
+class HexTable {
+public:
+  unsigned char value[256];
+
+  HexTable() {
+    memset(value, 0xff, sizeof(value));
+    for (int i = 0; i < 10; i++) {
+      value['0' + i] = i;
+    }
+    for (int i = 0; i < 6; i++) {
+      value['a' + i] = 10 + i;
+      value['A' + i] = 10 + i;
+    }
+  }
+};
+
+const HexTable hex;
+
+inline unsigned char hexDigit(const char c) {
+  return hex.value[(unsigned char)c];
+}
+
+inline const char* skipSpaces(const char* p, const char* eol) {
+  while (p < eol && (*p == ' ' || *p == '\t')) {
+    p++;
+  }
+  return p;
+}
+
+inline const char* skipToken(const char* p, const char* eol) {
+  while (p < eol && *p != ' ' && *p != '\t') {
+    p++;
+  }
+  return p;
+}
+
+/* <seconds>.<fraction> in ns, 0 when there is no number at p */
+inline const char* parseTime(const char* p, const char* eol, uint64_t& ns) {
+  uint64_t seconds = 0;
+  const char *start = p;
+
+  while (p < eol && (unsigned char)(*p - '0') < 10) {
+    seconds = seconds * 10 + (*p++ - '0');
+  }
+
+  if (p == start) {
+    return 0;
+  }
+
+  uint64_t fraction = 0;
+  uint64_t scale    = 1000000000u;
+
+  if (p < eol && *p == '.') {
+    p++;
+    while (p < eol && (unsigned char)(*p - '0') < 10) {
+      if (scale > 1) {
+        scale /= 10;
+        fraction += (*p - '0') * scale;
+      }
+      p++;
+    }
+  }
+
+  ns = seconds * 1000000000u + fraction;
+  return p;
+}
+
+/* standard (11 bit) id in hex, the extended ids of both formats have more digits */
+inline const char* parseId(const char* p, const char* eol, unsigned int& id) {
+  const char *start = p;
+
+  id = 0;
+  while (p < eol && hexDigit(*p) != 0xff) {
+    id = id << 4 | hexDigit(*p++);
+  }
+
+  return p == start || p - start > 3 ? 0 : p;
+}
+
+}
+
+IDriveLogReplay::IDriveLogReplay():begin(0),end(0),cursor(0) {
+}
+
+IDriveLogReplay::~IDriveLogReplay() {
+  close();
+}
+
+bool IDriveLogReplay::open(const char* path) {
+
+  close();
+
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) < 0) {
+    ::close(fd);
+    return false;
+  }
+
+  if (info.st_size > 0) {
+    // read ahead as next() goes rather than faulting the whole log in here
+    void *map = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      ::close(fd);
+      return false;
+    }
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+
+    begin = static_cast<const char*>(map);
+    end   = begin + info.st_size;
+  }
+
+  ::close(fd);
+
+  cursor   = begin;
+  lines    = 0;
+  messages = 0;
+  return true;
+}
+
+void IDriveLogReplay::close(void) {
+  if (begin) {
+    munmap(const_cast<char*>(begin), end - begin);
+  }
+  begin  = 0;
+  end    = 0;
+  cursor = 0;
+}
+
+bool IDriveLogReplay::next(unsigned char (&data)[8], uint64_t& timestamp) {
+
+  while (cursor < end) {
+    const char *p   = cursor;
+    const char *eol = static_cast<const char*>(memchr(p, '\n', end - p));
+
+    // the last line may lack its newline
+    if (!eol) {
+      eol = end;
+    }
+
+    cursor = eol < end ? eol + 1 : end;
+    lines++;
+
+    p = skipSpaces(p, eol);
+
+    if (p == eol) {
+      continue;
+    }
+
+    if (*p == '(' ? parseCandump(p + 1, eol, data, timestamp) : parseAsc(p, eol, data, timestamp)) {
+      messages++;
+      return true;
+    }
+  }
+
+  cursor = end;
+  return false;
+}
+
+bool IDriveLogReplay::parseCandump(const char* p, const char* eol, unsigned char (&data)[8], uint64_t& timestamp) const {
+
+  p = parseTime(p, eol, timestamp);
+  if (!p || p == eol || *p++ != ')') {
+    return false;
+  }
+
+  // interface
+  p = skipToken(skipSpaces(p, eol), eol);
+  p = skipSpaces(p, eol);
+
+  unsigned int id;
+  p = parseId(p, eol, id);
+  if (!p || id != 0x25B || eol - p < 17 || *p++ != '#') {
+    return false;
+  }
+
+  for (int i = 0; i < 8; i++) {
+    const unsigned char high = hexDigit(*p++);
+    const unsigned char low  = hexDigit(*p++);
+    if ((high | low) == 0xff) {
+      return false;
+    }
+    data[i] = high << 4 | low;
+  }
+
+  return true;
+}
+
+bool IDriveLogReplay::parseAsc(const char* p, const char* eol, unsigned char (&data)[8], uint64_t& timestamp) const {
+
+  p = parseTime(p, eol, timestamp);
+  if (!p) {
+    return false;
+  }
+
+  // channel
+  p = skipToken(skipSpaces(p, eol), eol);
+  p = skipSpaces(p, eol);
+
+  unsigned int id;
+  p = parseId(p, eol, id);
+  if (!p || id != 0x25B || (p < eol && *p != ' ' && *p != '\t')) {
+    return false;
+  }
+
+  // direction, then 'd' and the length of a data frame
+  p = skipToken(skipSpaces(p, eol), eol);
+  p = skipSpaces(p, eol);
+  if (eol - p < 3 || p[0] != 'd') {
+    return false;
+  }
+  p = skipSpaces(p + 1, eol);
+  if (p == eol || *p++ != '8') {
+    return false;
+  }
+
+  for (int i = 0; i < 8; i++) {
+    p = skipSpaces(p, eol);
+    if (eol - p < 2) {
+      return false;
+    }
+    const unsigned char high = hexDigit(*p++);
+    const unsigned char low  = hexDigit(*p++);
+    if ((high | low) == 0xff) {
+      return false;
+    }
+    data[i] = high << 4 | low;
+  }
+
+  return true;
+}
@@ -0,0 +1,81 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVELOGREPLAY_H_
+#define IDRIVELOGREPLAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* replays the 0x25B CAN-messages of a text log. The file is mapped into
+ * memory and parsed in place, nothing is allocated per line. Understands
+ *
+ *   candump -l:  (1436509052.249713) can0 25B#01FF7F000400C0F8
+ *   Vector ASC:     12.345678 1  25B             Rx   d 8 01 FF 7F 00 04 00 C0 F8
+ *
+ * and skips every other line (headers, other ids, extended ids, short messages).
+ */
+class IDriveLogReplay {
+public:
+
+  size_t lines     = 0;
+  size_t messages  = 0;  // 0x25B messages returned by next()
+
+  IDriveLogReplay();
+  ~IDriveLogReplay();
+
+  /* returns false and leaves errno set on failure */
+  bool open(const char* path);
+  void close(void);
+
+  /* parses up to the next 0x25B message, returns false at the end of the
+   * log. timestamp is in ns (seconds since the epoch for candump, since the
+   * start of the measurement for ASC).
+   */
+  bool next(unsigned char (&data)[8], uint64_t& timestamp);
+
+  template<class Decoder>
+  inline size_t decode(Decoder& decoder) {
+    unsigned char data[8];
+    uint64_t      timestamp;
+    size_t        n = 0;
+    while (next(data, timestamp)) {
+      decoder.decode(data);
+      n++;
+    }
+    return n;
+  }
+
+  inline size_t size(void) const {
+    return end - begin;
+  }
+
+private:
+  const char *begin;
+  const char *end;
+  const char *cursor;
+
+  bool parseCandump(const char* p, const char* eol, unsigned char (&data)[8], uint64_t& timestamp) const;
+  bool parseAsc(const char* p, const char* eol, unsigned char (&data)[8], uint64_t& timestamp) const;
+
+  IDriveLogReplay(const IDriveLogReplay&);
+  IDriveLogReplay& operator=(const IDriveLogReplay&);
+};
+
+#endif /* IDRIVELOGREPLAY_H_ */
@@ -0,0 +1,183 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveParallelDecoder.h"
+
+#include <string.h>
+#include <thread>
+
+namespace {
+
+// below this a chunk is not worth a thread
+const size_t minChunk     = 16384;
+const size_t batchRecords = 4096;
+
+struct Chunk {
+  size_t                         begin;
+  size_t                         end;
+  IDriveDecoderCore              start;
+  IDriveDecoderCore              decoder;
+  std::vector<IDriveEventRecord> records;
+};
+
+bool sameState(const IDriveDecoderCore& a, const IDriveDecoderCore& b) {
+  IDriveDecoderState x, y;
+  a.saveState(x);
+  b.saveState(y);
+  return !memcmp(&x, &y, sizeof(x));
+}
+
+// the state after frame if it was accepted, whatever came before it
+void speculate(IDriveDecoderCore& decoder, const uint8_t (&frame)[8]) {
+  uint8_t data[8];
+  memcpy(data, frame, sizeof(data));
+  data[0] = 0;
+
+  IDriveEvents events;
+  decoder.decode(data, events);
+
+  IDriveDecoderState state;
+  decoder.saveState(state);
+  state.counter = frame[0];
+  decoder.restoreState(state);
+}
+
+void decodeChunk(Chunk& chunk, const uint8_t (*frames)[8]) {
+  size_t i    = chunk.begin;
+  size_t used = 0;
+
+  chunk.decoder = chunk.start;
+
+  while (i < chunk.end) {
+    chunk.records.resize(used + batchRecords);
+
+    IDriveEventSink sink = { chunk.records.data() + used, batchRecords, 0 };
+    const size_t consumed = chunk.decoder.decodeBatch(frames + i, chunk.end - i, sink);
+
+    for (size_t r = 0; r < sink.count; r++) {
+      sink.records[r].frame += i;
+    }
+
+    used += sink.count;
+    i    += consumed;
+  }
+
+  chunk.records.resize(used);
+}
+
+}
+
+IDriveParallelDecoder::IDriveParallelDecoder(const unsigned threads):threads(threads) {
+  if (!this->threads) {
+    this->threads = std::thread::hardware_concurrency();
+  }
+  if (!this->threads) {
+    this->threads = 1;
+  }
+}
+
+void IDriveParallelDecoder::decode(const uint8_t (*frames)[8], const size_t n, std::vector<IDriveEventRecord>& records) {
+
+  size_t count = n / minChunk;
+  if (count > threads) {
+    count = threads;
+  }
+  if (count < 1) {
+    count = 1;
+  }
+
+  std::vector<Chunk> chunks(count);
+
+  for (size_t c = 0; c < count; c++) {
+    Chunk &chunk = chunks[c];
+    chunk.begin = n * c / count;
+    chunk.end   = n * (c + 1) / count;
+
+    if (c == 0) {
+      chunk.start = decoder;
+    } else {
+      speculate(chunk.start, frames[chunk.begin - 1]);
+    }
+  }
+
+  std::vector<std::thread> workers;
+  for (size_t c = 1; c < count; c++) {
+    workers.push_back(std::thread(decodeChunk, std::ref(chunks[c]), frames));
+  }
+  decodeChunk(chunks[0], frames);
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+
+  for (size_t c = 1; c < count; c++) {
+    Chunk &chunk = chunks[c];
+
+    IDriveDecoderCore truth       = chunks[c - 1].decoder;
+    IDriveDecoderCore speculative = chunk.start;
+
+    std::vector<IDriveEventRecord> fixed;
+    size_t i = chunk.begin;
+
+    while (i < chunk.end && !sameState(truth, speculative)) {
+      IDriveEventRecord buffer[IDRIVEDECODER_MAX_EVENTS];
+      IDriveEventSink   sink = { buffer, IDRIVEDECODER_MAX_EVENTS, 0 };
+
+      truth.decodeBatch(frames + i, 1, sink);
+
+      for (size_t r = 0; r < sink.count; r++) {
+        buffer[r].frame = i;
+        fixed.push_back(buffer[r]);
+      }
+
+      IDriveEvents events;
+      speculative.decode(frames[i], events);
+      i++;
+    }
+
+    resynced += i - chunk.begin;
+
+    if (i == chunk.begin) {
+      continue;
+    }
+
+    // records of the messages decoded again are replaced
+    size_t stale = 0;
+    while (stale < chunk.records.size() && chunk.records[stale].frame < i) {
+      stale++;
+    }
+    chunk.records.erase(chunk.records.begin(), chunk.records.begin() + stale);
+    chunk.records.insert(chunk.records.begin(), fixed.begin(), fixed.end());
+
+    if (!sameState(truth, speculative)) {
+      chunk.decoder = truth;
+    }
+  }
+
+  size_t total = records.size();
+  for (size_t c = 0; c < count; c++) {
+    total += chunks[c].records.size();
+  }
+  records.reserve(total);
+
+  for (size_t c = 0; c < count; c++) {
+    records.insert(records.end(), chunks[c].records.begin(), chunks[c].records.end());
+  }
+
+  decoder = chunks[count - 1].decoder;
+}
@@ -0,0 +1,63 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEPARALLELDECODER_H_
+#define IDRIVEPARALLELDECODER_H_
+
+#include <IDriveDecoder.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* decodes a recorded log on several threads.
+ *
+ * The log is split into one chunk per thread. Every chunk starts from a
+ * speculative state: the state its first message would have if the message
+ * before it was accepted. Once all chunks are decoded, the boundaries are
+ * fixed up in order. The true state is carried over from the previous chunk
+ * and both decoders are stepped in lockstep until their states agree. From
+ * then on the speculative records are correct. The fix-up normally takes a
+ * single message and never goes beyond a message with counter 0, which
+ * resets both decoders. The records are identical to a single decodeBatch
+ * over the whole log.
+ */
+class IDriveParallelDecoder {
+public:
+
+  size_t resynced = 0;  // messages decoded again while fixing up boundaries
+
+  /* threads == 0 uses every hardware thread */
+  explicit IDriveParallelDecoder(const unsigned threads = 0);
+
+  /* appends the records of n consecutive messages, frame is the index within
+   * frames. Continues from the state the previous call ended with.
+   */
+  void decode(const uint8_t (*frames)[8], const size_t n, std::vector<IDriveEventRecord>& records);
+
+  inline const IDriveDecoderCore& state(void) const {
+    return decoder;
+  }
+
+private:
+  unsigned          threads;
+  IDriveDecoderCore decoder;
+};
+
+#endif /* IDRIVEPARALLELDECODER_H_ */
@@ -0,0 +1,124 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveSocketCan.h"
+
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <string.h>
+#include <unistd.h>
+
+IDriveSocketCan::IDriveSocketCan():fd(-1) {
+  memset(messages, 0, sizeof(messages));
+  for (unsigned int i = 0; i < batchSize; i++) {
+    iov[i].iov_base = &frames[i];
+    iov[i].iov_len  = sizeof(frames[i]);
+  }
+}
+
+IDriveSocketCan::~IDriveSocketCan() {
+  close();
+}
+
+bool IDriveSocketCan::open(const char* interface) {
+
+  close();
+
+  const unsigned int index = if_nametoindex(interface);
+  if (!index) {
+    return false;
+  }
+
+  fd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+  if (fd < 0) {
+    return false;
+  }
+
+  // standard frames with exactly this id, no remote requests
+  struct can_filter filter;
+  filter.can_id   = canId;
+  filter.can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG;
+
+  const int on = 1;
+
+  struct sockaddr_can address;
+  memset(&address, 0, sizeof(address));
+  address.can_family  = AF_CAN;
+  address.can_ifindex = index;
+
+  if (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, &filter, sizeof(filter)) < 0
+      || setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0
+      || bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void IDriveSocketCan::close(void) {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+int IDriveSocketCan::receive(void) {
+
+  for (unsigned int i = 0; i < batchSize; i++) {
+    struct msghdr &header = messages[i].msg_hdr;
+    header.msg_iov        = &iov[i];
+    header.msg_iovlen     = 1;
+    header.msg_control    = control[i];
+    header.msg_controllen = sizeof(control[i]);
+  }
+
+  // block for the first message only, then take whatever else is queued
+  const int received = recvmmsg(fd, messages, batchSize, MSG_WAITFORONE, 0);
+  if (received < 0) {
+    return -1;
+  }
+
+  int n = 0;
+
+  for (int i = 0; i < received; i++) {
+    if (messages[i].msg_len < sizeof(struct can_frame) || frames[i].can_dlc < 8) {
+      continue;
+    }
+
+    uint64_t stamp = 0;
+    struct msghdr &header = messages[i].msg_hdr;
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&header); c; c = CMSG_NXTHDR(&header, c)) {
+      if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+        struct timespec time;
+        memcpy(&time, CMSG_DATA(c), sizeof(time));
+        stamp = (uint64_t)time.tv_sec * 1000000000u + time.tv_nsec;
+      }
+    }
+
+    // short messages are rare, keep the rest contiguous
+    if (n != i) {
+      frames[n] = frames[i];
+    }
+    stamps[n++] = stamp;
+  }
+
+  return n;
+}
@@ -0,0 +1,87 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVESOCKETCAN_H_
+#define IDRIVESOCKETCAN_H_
+
+#include <linux/can.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+
+/* receives the 0x25B CAN-messages of a Linux SocketCAN interface (can0,
+ * vcan0, ...) in batches: the kernel filters for the id, one recvmmsg call
+ * fetches up to batchSize messages together with their kernel timestamps.
+ * Decoders read the payload straight out of the receive buffers.
+ */
+class IDriveSocketCan {
+public:
+
+  static const canid_t      canId     = 0x25B;
+  static const unsigned int batchSize = 64;
+
+  IDriveSocketCan();
+  ~IDriveSocketCan();
+
+  /* returns false and leaves errno set on failure */
+  bool open(const char* interface);
+  void close(void);
+
+  /* waits for at least one message, returns the number received (up to
+   * batchSize) or -1 with errno set. Messages shorter than 8 bytes are dropped.
+   */
+  int receive(void);
+
+  inline const unsigned char* data(const unsigned int i) const {
+    return frames[i].data;
+  }
+
+  /* kernel receive time in ns since the epoch */
+  inline uint64_t timestamp(const unsigned int i) const {
+    return stamps[i];
+  }
+
+  /* receives one batch and runs each message through decoder.decode() */
+  template<class Decoder>
+  inline int decode(Decoder& decoder) {
+    const int n = receive();
+    for (int i = 0; i < n; i++) {
+      decoder.decode(frames[i].data);
+    }
+    return n;
+  }
+
+  inline int descriptor(void) const {
+    return fd;
+  }
+
+private:
+  int              fd;
+  struct can_frame frames[batchSize];
+  uint64_t         stamps[batchSize];
+  struct iovec     iov[batchSize];
+  struct mmsghdr   messages[batchSize];
+  char             control[batchSize][CMSG_SPACE(sizeof(struct timespec))];
+
+  IDriveSocketCan(const IDriveSocketCan&);
+  IDriveSocketCan& operator=(const IDriveSocketCan&);
+};
+
+#endif /* IDRIVESOCKETCAN_H_ */
@@ -0,0 +1,82 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveStatePublisher.h"
+
+#include <string.h>
+
+IDriveStatePublisher::IDriveStatePublisher():sequence(0),held(0),longHeld(0),position(0),counter(0),total(0),lastPos(0),positioned(false) {
+  memset(switches, 0, sizeof(switches));
+}
+
+void IDriveStatePublisher::publish(const IDriveDecoderCore& decoder, const IDriveEvents& events, const unsigned char status) {
+
+  if (status & IDRIVEDECODER_STALE) {
+    return;
+  }
+
+  // nothing but the counter changed, a reset may have cleared the inputs though
+  if (!events.mask && !events.rotary && !(status & IDRIVEDECODER_RESET) && positioned) {
+    const uint64_t begin = sequence.load(std::memory_order_relaxed);
+    sequence.store(begin + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    counter.store(decoder.counter(), std::memory_order_relaxed);
+
+    sequence.store(begin + 2, std::memory_order_release);
+    return;
+  }
+
+  publish(decoder);
+}
+
+void IDriveStatePublisher::publish(const IDriveDecoderCore& decoder) {
+
+  IDriveDecoderState state;
+  decoder.saveState(state);
+
+  // the 16 bit position wraps, the difference to the last one does not
+  if (positioned) {
+    total += (short)(state.pos - lastPos);
+    lastPos = state.pos;
+  } else if (decoder.accepted()) {
+    total      = state.pos;
+    lastPos    = state.pos;
+    positioned = true;
+  }
+
+  const bool inputs = memcmp(switches, state.switches, sizeof(switches));
+  if (inputs) {
+    memcpy(switches, state.switches, sizeof(switches));
+  }
+
+  const uint64_t begin = sequence.load(std::memory_order_relaxed);
+  sequence.store(begin + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (inputs) {
+    held.store(IDriveDecoderCore::held(state.switches), std::memory_order_relaxed);
+    longHeld.store(IDriveDecoderCore::longHeld(state.switches), std::memory_order_relaxed);
+  }
+
+  position.store(total, std::memory_order_relaxed);
+  counter.store(state.counter, std::memory_order_relaxed);
+
+  sequence.store(begin + 2, std::memory_order_release);
+}
@@ -0,0 +1,94 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVESTATEPUBLISHER_H_
+#define IDRIVESTATEPUBLISHER_H_
+
+#include <IDriveDecoder.h>
+
+#include <atomic>
+#include <stdint.h>
+
+/* the controller state as seen by the last CAN-message */
+struct IDriveSnapshot {
+  uint64_t sequence;  // messages published, changes with every publish
+  uint64_t held;      // IDRIVEDECODER_EVENT(press-eventId) of the inputs pressed or long pressed
+  uint64_t longHeld;  // the same for the inputs long pressed
+  int32_t  position;  // rotary position of the decoder, extended to 32 bits across wraps, 0 until known
+  uint8_t  counter;   // of the last accepted CAN-message
+};
+
+/* shares the state of one decoder with any number of threads.
+ *
+ * The decode thread calls publish after every decode and after anything
+ * else that changes the decoder, e.g. release(). Other threads poll read.
+ * The snapshot is guarded by a seqlock: publish never waits or takes a
+ * lock, read retries while a publish is under way. Only one thread may
+ * publish.
+ */
+class alignas(64) IDriveStatePublisher {
+public:
+
+  IDriveStatePublisher();
+
+  /* publishes the state of decoder after decode returned events and status.
+   * Without events only the counter is published. */
+  void publish(const IDriveDecoderCore& decoder, const IDriveEvents& events, const unsigned char status);
+
+  /* publishes the state of decoder without a CAN-message, e.g. once
+   * IDriveInputTimer released the held inputs */
+  void publish(const IDriveDecoderCore& decoder);
+
+  inline void read(IDriveSnapshot& snapshot) const {
+    uint64_t before;
+    uint64_t after;
+
+    do {
+      before = sequence.load(std::memory_order_acquire);
+
+      snapshot.held     = held.load(std::memory_order_relaxed);
+      snapshot.longHeld = longHeld.load(std::memory_order_relaxed);
+      snapshot.position = position.load(std::memory_order_relaxed);
+      snapshot.counter  = counter.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    snapshot.sequence = before >> 1;
+  }
+
+private:
+
+  // odd while publish writes
+  std::atomic<uint64_t> sequence;
+
+  std::atomic<uint64_t> held;
+  std::atomic<uint64_t> longHeld;
+  std::atomic<int32_t>  position;
+  std::atomic<uint8_t>  counter;
+
+  // owned by the publishing thread
+  int32_t        total;
+  unsigned short lastPos;
+  bool           positioned;   // total holds a position
+  unsigned char  switches[3];  // of the last publish
+};
+
+#endif /* IDRIVESTATEPUBLISHER_H_ */
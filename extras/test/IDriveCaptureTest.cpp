@@ -0,0 +1,155 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveCaptureWriter and IDriveCaptureReader: the messages read back, and
+ * seek to the decoder state a replay from the start would have */
+
+#include "IDriveCapture.h"
+#include "IDriveTest.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static const size_t captureFrames = 20000;
+
+static bool sameState(const IDriveDecoderCore& a, const IDriveDecoderCore& b) {
+  IDriveDecoderState stateA, stateB;
+  a.saveState(stateA);
+  b.saveState(stateB);
+  return !memcmp(&stateA, &stateB, sizeof(stateA));
+}
+
+static void checkRead(IDriveCaptureReader& reader, const uint8_t (*frames)[8], const uint64_t* timestamps) {
+  const unsigned char *data;
+  uint64_t             timestamp;
+  unsigned char        flags;
+  size_t               n = 0;
+
+  bool same = true;
+  while (reader.next(data, timestamp, flags)) {
+    same = same && n < captureFrames && !memcmp(data, frames[n], 8) && timestamp == timestamps[n] && flags == (n & 0xff);
+    n++;
+  }
+
+  IDRIVE_CHECK(same);
+  IDRIVE_CHECK(n == captureFrames);
+}
+
+/* seek to the message at index k has to leave the decoder as decoding the
+ * messages before k does */
+static void checkSeek(IDriveCaptureReader& reader, const uint8_t (*frames)[8], const uint64_t* timestamps, const uint64_t timestamp) {
+  size_t k = 0;
+  while (k < captureFrames && timestamps[k] < timestamp) {
+    k++;
+  }
+
+  IDriveDecoderCore decoder;
+  const bool found = reader.seek(timestamp, decoder);
+  IDRIVE_CHECK(found == (k < captureFrames));
+  if (!found || k == captureFrames) {
+    return;
+  }
+
+  // the blocks start from a saved state, the replay from the beginning
+  IDriveDecoderCore expected;
+  for (size_t i = 0; i < k; i++) {
+    IDriveEvents events;
+    expected.decode(frames[i], events);
+  }
+  IDRIVE_CHECK(sameState(decoder, expected));
+
+  const unsigned char *data;
+  uint64_t             current;
+  unsigned char        flags;
+  IDRIVE_CHECK(reader.next(data, current, flags));
+  IDRIVE_CHECK(!memcmp(data, frames[k], 8) && current == timestamps[k]);
+}
+
+static void checkSeeks(IDriveCaptureReader& reader, const uint8_t (*frames)[8], const uint64_t* timestamps) {
+  IDriveTestRandom random(0x13);
+
+  checkSeek(reader, frames, timestamps, 0);
+  checkSeek(reader, frames, timestamps, timestamps[0]);
+  checkSeek(reader, frames, timestamps, timestamps[captureFrames - 1]);
+  checkSeek(reader, frames, timestamps, timestamps[captureFrames - 1] + 1);
+
+  for (int i = 0; i < 40; i++) {
+    const size_t k = random.below(captureFrames);
+    checkSeek(reader, frames, timestamps, timestamps[k]);
+    checkSeek(reader, frames, timestamps, timestamps[k] - 1);
+    checkSeek(reader, frames, timestamps, timestamps[k] + 1);
+  }
+}
+
+int main() {
+  std::vector<uint8_t>  buffer(captureFrames * 8);
+  std::vector<uint64_t> timestamps(captureFrames);
+  uint8_t (*frames)[8] = reinterpret_cast<uint8_t (*)[8]>(buffer.data());
+
+  idriveRandomTraffic(frames, captureFrames, 0x13);
+
+  // whole us about 1 ms apart, a few messages in the same us and one gap
+  // too long for a record
+  IDriveTestRandom random(0x0d);
+  uint64_t         now = 1600000000000000000ull;
+  for (size_t i = 0; i < captureFrames; i++) {
+    now += i == captureFrames / 2 ? 5000000000000000ull : random.below(8) ? 1000000 + random.below(100) * 1000 : 0;
+    timestamps[i] = now;
+  }
+
+  char path[] = "/tmp/idrive-capture-XXXXXX";
+  const int fd = mkstemp(path);
+  IDRIVE_CHECK(fd >= 0);
+  close(fd);
+
+  IDriveCaptureWriter writer(256);
+  IDRIVE_CHECK(writer.open(path));
+  for (size_t i = 0; i < captureFrames; i++) {
+    IDRIVE_CHECK(writer.write(frames[i], timestamps[i], i & 0xff));
+  }
+  IDRIVE_CHECK(writer.close());
+
+  IDriveCaptureReader reader;
+  IDRIVE_CHECK(reader.open(path));
+  IDRIVE_CHECK(reader.frames() == captureFrames);
+  IDRIVE_CHECK(reader.blocks().size() > captureFrames / 256);
+
+  checkRead(reader, frames, timestamps.data());
+  checkSeeks(reader, frames, timestamps.data());
+
+  // without index and trailer, as left by a writer that did not close
+  const uint64_t indexOffset = reader.blocks().size() * sizeof(IDriveCaptureIndex) + sizeof(IDriveCaptureTrailer);
+  FILE *file = fopen(path, "rb");
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fclose(file);
+  reader.close();
+
+  IDRIVE_CHECK(truncate(path, size - indexOffset) == 0);
+  IDRIVE_CHECK(reader.open(path));
+  IDRIVE_CHECK(reader.frames() == captureFrames);
+
+  checkRead(reader, frames, timestamps.data());
+  checkSeeks(reader, frames, timestamps.data());
+
+  reader.close();
+  unlink(path);
+
+  return idriveTestResult();
+}
@@ -0,0 +1,171 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveDecoderBank has to decode the interleaved traffic of several
+ * controllers like one IDriveDecoderCore per CAN id */
+
+#include <IDriveDecoderBank.h>
+
+#include "IDriveTest.h"
+
+#include <vector>
+
+static const size_t   controllers      = 40;
+static const size_t   controllerFrames = 5000;
+static const uint32_t unknownId        = 0x7ff;
+
+typedef std::vector<IDriveEventRecord> Records;
+
+static void append(const IDriveEvents& events, const uint32_t frame, Records& records) {
+  IDriveEventRecord buffer[IDRIVEDECODER_MAX_EVENTS];
+  IDriveEventSink   sink = { buffer, IDRIVEDECODER_MAX_EVENTS, 0 };
+
+  IDriveDecoderCore::record(events, frame, sink);
+  records.insert(records.end(), buffer, buffer + sink.count);
+}
+
+static bool sameRecords(const Records& a, const Records& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].frame != b[i].frame || a[i].value != b[i].value || a[i].eventId != b[i].eventId) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void testSlots(void) {
+  IDriveDecoderBank<4> bank;
+
+  // ids that differ in the high bits only, and an extended one
+  const uint32_t ids[] = { 0x25b, 0x1025b, 0x2025b, 0x1fffffff };
+
+  for (int i = 0; i < 4; i++) {
+    IDRIVE_CHECK(bank.add(ids[i]) == i);
+  }
+  for (int i = 0; i < 4; i++) {
+    IDRIVE_CHECK(bank.add(ids[i]) == i);
+    IDRIVE_CHECK(bank.slot(ids[i]) == i);
+    IDRIVE_CHECK(bank.canId(i) == ids[i]);
+  }
+
+  IDRIVE_CHECK(bank.size() == 4);
+  IDRIVE_CHECK(bank.add(0x3025b) == -1);
+  IDRIVE_CHECK(bank.slot(0x3025b) == -1);
+
+  IDriveEvents        events = { 1, 1 };
+  const unsigned char data[8] = { 0x01, 0x02, 0x80, 0x00, 0x04, 0x00, 0xc0, 0xf8 };
+  IDRIVE_CHECK(bank.decode(0x3025b, data, events) == -1);
+  IDRIVE_CHECK(!events.mask && !events.rotary);
+}
+
+int main() {
+  const size_t n = controllers * controllerFrames;
+
+  // every controller has its own traffic, the messages are interleaved at random
+  std::vector<uint8_t> traffic(n * 8);
+  uint8_t (*perController)[8] = reinterpret_cast<uint8_t (*)[8]>(traffic.data());
+  for (size_t c = 0; c < controllers; c++) {
+    idriveRandomTraffic(perController + c * controllerFrames, controllerFrames, 0x16 + c);
+  }
+
+  std::vector<uint8_t>  buffer((n + n / 16) * 8);
+  std::vector<uint32_t> canIds;
+  std::vector<size_t>   next(controllers, 0);
+  uint8_t (*frames)[8] = reinterpret_cast<uint8_t (*)[8]>(buffer.data());
+  IDriveTestRandom random(0x16);
+
+  while (canIds.size() < buffer.size() / 8) {
+    const size_t c = random.below(controllers + 1);
+    const size_t i = canIds.size();
+
+    if (c == controllers) {
+      memset(frames[i], 0, 8);
+      canIds.push_back(unknownId);
+    } else if (next[c] < controllerFrames) {
+      memcpy(frames[i], perController[c * controllerFrames + next[c]++], 8);
+      canIds.push_back(0x100 + 0x40000 * c);
+    }
+  }
+
+  // one decoder per id
+  std::vector<IDriveDecoderCore> decoders(controllers);
+  Records                        expected;
+  for (size_t i = 0; i < canIds.size(); i++) {
+    if (canIds[i] != unknownId) {
+      IDriveEvents events;
+      decoders[(canIds[i] - 0x100) / 0x40000].decode(frames[i], events);
+      append(events, i, expected);
+    }
+  }
+
+  IDriveDecoderBank<64> bank;
+  for (size_t c = 0; c < controllers; c++) {
+    IDRIVE_CHECK(bank.add(0x100 + 0x40000 * c) == (int)c);
+  }
+
+  // per message
+  Records records;
+  for (size_t i = 0; i < canIds.size(); i++) {
+    IDriveEvents events;
+    if (bank.decode(canIds[i], frames[i], events) >= 0) {
+      append(events, i, records);
+    }
+  }
+  IDRIVE_CHECK(sameRecords(expected, records));
+
+  // in batches into a sink that fills up often
+  IDriveDecoderBank<64> batched;
+  for (size_t c = 0; c < controllers; c++) {
+    batched.add(0x100 + 0x40000 * c);
+  }
+
+  Records batch(IDRIVEDECODER_MAX_EVENTS * 3);
+  records.clear();
+  for (size_t i = 0; i < canIds.size();) {
+    IDriveEventSink sink = { batch.data(), batch.size(), 0 };
+    const size_t consumed = batched.decodeBatch(canIds.data() + i, frames + i, canIds.size() - i, sink);
+
+    IDRIVE_CHECK(consumed > 0);
+    for (size_t r = 0; r < sink.count; r++) {
+      batch[r].frame += i;
+    }
+    records.insert(records.end(), batch.begin(), batch.begin() + sink.count);
+    i += consumed;
+  }
+  IDRIVE_CHECK(sameRecords(expected, records));
+
+  // a reset slot decodes like a fresh decoder
+  bank.reset(3);
+  decoders[3] = IDriveDecoderCore();
+  for (size_t i = 0; i < controllerFrames; i++) {
+    IDriveEvents a, b;
+    bank.decodeSlot(3, perController[i], a);
+    decoders[3].decode(perController[i], b);
+    IDRIVE_CHECK(a.mask == b.mask && a.rotary == b.rotary);
+  }
+
+  testSlots();
+
+  return idriveTestResult();
+}
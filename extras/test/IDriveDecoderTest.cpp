@@ -0,0 +1,374 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* checks IDriveDecoder against IDriveEncoder, against the if/else ladder the
+ * decoder was originally written as, and its interfaces against each other */
+
+#include <IDriveDecoder.h>
+#include <IDriveEncoder.h>
+
+#include "IDriveTest.h"
+
+#include <vector>
+
+typedef std::vector<IDriveEventRecord> Records;
+
+static const size_t trafficFrames = 200000;
+
+/* the original decoder: one if/else per input, events are reported as
+ * they are found */
+class LadderDecoder {
+public:
+
+  Records records;
+
+  LadderDecoder() {
+    reset();
+  }
+
+  void decode(const unsigned char* data, const uint32_t frame) {
+    const unsigned char counter = data[0];
+
+    if (counter == 0) {
+      reset();
+    }
+
+    if ((unsigned char)(counter - lastCounter) > 0x7f) {
+      return;
+    }
+
+    lastCounter = counter;
+
+    const unsigned short pos = data[2] << 8 | data[1];
+
+    if (pos != lastPos) {
+      emit(frame, IDRIVEDECODER_ROTARY, pos - lastPos);
+      lastPos = pos;
+    }
+
+    const unsigned char d3 = data[3];
+    const unsigned char d4 = data[4];
+    const unsigned char d5 = data[5];
+    const unsigned char d6 = data[6];
+    const unsigned char d7 = data[7];
+
+    input(frame, last[0],  d3 & 0x01,            d3 & 0x02,            IDRIVEDECODER_CENTER);
+    input(frame, last[1],  (d3 & 0xf0) == 0xa0,  (d3 & 0xf0) == 0xb0,  IDRIVEDECODER_LEFT);
+    input(frame, last[2],  (d3 & 0xf0) == 0x10,  (d3 & 0xf0) == 0x20,  IDRIVEDECODER_UP);
+    input(frame, last[3],  (d3 & 0xf0) == 0x40,  (d3 & 0xf0) == 0x50,  IDRIVEDECODER_RIGHT);
+    input(frame, last[4],  (d3 & 0xf0) == 0x70,  (d3 & 0xf0) == 0x80,  IDRIVEDECODER_DOWN);
+    input(frame, last[5],  d4 & 0x04,            d4 & 0x08,            IDRIVEDECODER_MENU);
+    input(frame, last[6],  d4 & 0x20,            d4 & 0x40,            IDRIVEDECODER_BACK);
+    input(frame, last[7],  d5 & 0x08,            d5 & 0x10,            IDRIVEDECODER_COM);
+    input(frame, last[8],  d5 & 0x01,            d5 & 0x02,            IDRIVEDECODER_OPTION);
+    input(frame, last[9],  d6 & 0x01,            d6 & 0x02,            IDRIVEDECODER_MEDIA);
+    input(frame, last[10], d6 & 0x08,            d6 & 0x10,            IDRIVEDECODER_NAV);
+    input(frame, last[11], d7 & 0x01,            d7 & 0x02,            IDRIVEDECODER_MAP);
+  }
+
+private:
+  enum { released, pressed, longPressed };
+
+  unsigned char  lastCounter;
+  unsigned short lastPos;
+  unsigned char  last[12];
+
+  void reset(void) {
+    lastCounter = 0xff;
+    lastPos     = 0x7fff;
+    memset(last, released, sizeof(last));
+  }
+
+  void input(const uint32_t frame, unsigned char& state, const bool press, const bool ext, const unsigned char eventId) {
+    if (press) {
+      if (state != pressed) {
+        state = pressed;
+        emit(frame, eventId, 0);
+      }
+    } else if (ext) {
+      if (state != longPressed) {
+        state = longPressed;
+        emit(frame, eventId + 1, 0);
+      }
+    } else if (state != released) {
+      state = released;
+      emit(frame, eventId + 2, 0);
+    }
+  }
+
+  void emit(const uint32_t frame, const unsigned char eventId, const short value) {
+    IDriveEventRecord record;
+    record.frame   = frame;
+    record.value   = value;
+    record.eventId = eventId;
+    records.push_back(record);
+  }
+};
+
+static bool sameRecords(const Records& a, const Records& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].frame != b[i].frame || a[i].value != b[i].value || a[i].eventId != b[i].eventId) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// per-frame decode(data, events), records in the order dispatch reports them
+static void decodeFrames(const uint8_t (*frames)[8], const size_t n, Records& records) {
+  IDriveDecoderCore decoder;
+  IDriveEventRecord buffer[IDRIVEDECODER_MAX_EVENTS];
+
+  for (size_t i = 0; i < n; i++) {
+    IDriveEvents   events;
+    IDriveEventSink sink = { buffer, IDRIVEDECODER_MAX_EVENTS, 0 };
+
+    decoder.decode(frames[i], events);
+    IDriveDecoderCore::record(events, i, sink);
+    records.insert(records.end(), buffer, buffer + sink.count);
+  }
+}
+
+// the one event a single CAN-message of encoder is expected to decode to
+static void checkEvent(IDriveEncoder& encoder, IDriveDecoderCore& decoder, const unsigned char eventId) {
+  unsigned char data[8];
+  IDriveEvents  events;
+
+  encoder.apply(eventId);
+  encoder.encode(data);
+  decoder.decode(data, events);
+
+  IDRIVE_CHECK(events.mask == IDRIVEDECODER_EVENT(eventId));
+  IDRIVE_CHECK(events.rotary == 0);
+}
+
+static void testEncoderRoundTrip(void) {
+  IDriveEncoder     encoder;
+  IDriveDecoderCore decoder;
+  uint64_t          seen = 0;
+
+  for (unsigned char eventId = IDRIVEDECODER_CENTER; eventId <= IDRIVEDECODER_OPTION_REL; eventId += 3) {
+    checkEvent(encoder, decoder, eventId);
+    checkEvent(encoder, decoder, eventId + 1);
+    checkEvent(encoder, decoder, eventId);
+    checkEvent(encoder, decoder, eventId + 2);
+    seen |= IDRIVEDECODER_EVENT(eventId) | IDRIVEDECODER_EVENT(eventId + 1) | IDRIVEDECODER_EVENT(eventId + 2);
+  }
+
+  // all 36 ids
+  IDRIVE_CHECK(seen == IDRIVEDECODER_PRESS_EVENTS * 7);
+
+  const short moves[] = { 1, -1, 100, -300, 0x7fff, -0x7fff };
+
+  for (size_t m = 0; m < sizeof(moves) / sizeof(moves[0]); m++) {
+    unsigned char data[8];
+    IDriveEvents  events;
+
+    encoder.rotate(moves[m]);
+    encoder.encode(data);
+    decoder.decode(data, events);
+
+    IDRIVE_CHECK(events.rotary == moves[m]);
+    IDRIVE_CHECK(events.mask == 0);
+  }
+}
+
+static Records callbackRecords;
+static uint32_t callbackFrame;
+
+static void onSwitch(const unsigned char eventId) {
+  IDriveEventRecord record = { callbackFrame, 0, eventId };
+  callbackRecords.push_back(record);
+}
+
+static void onRotary(const short rotary) {
+  IDriveEventRecord record = { callbackFrame, rotary, IDRIVEDECODER_ROTARY };
+  callbackRecords.push_back(record);
+}
+
+static void testLadderOrder(const uint8_t (*frames)[8], const size_t n) {
+  LadderDecoder ladder;
+  auto decoder = makeIDriveDecoder(onSwitch, onRotary);
+
+  callbackRecords.clear();
+
+  for (size_t i = 0; i < n; i++) {
+    callbackFrame = i;
+    ladder.decode(frames[i], i);
+    decoder.decode(frames[i]);
+  }
+
+  IDRIVE_CHECK(!ladder.records.empty());
+  IDRIVE_CHECK(sameRecords(ladder.records, callbackRecords));
+
+  Records masked;
+  decodeFrames(frames, n, masked);
+  IDRIVE_CHECK(sameRecords(ladder.records, masked));
+}
+
+// decodeBatch into a sink that fills up often, it has to stop and continue
+template<class Decoder>
+static void decodeBatches(Decoder& decoder, const uint8_t (*frames)[8], const size_t n, Records& records) {
+  Records buffer(IDRIVEDECODER_MAX_EVENTS * 3);
+  size_t  i = 0;
+
+  while (i < n) {
+    IDriveEventSink sink = { buffer.data(), buffer.size(), 0 };
+    const size_t consumed = decoder.decodeBatch(frames + i, n - i, sink);
+
+    IDRIVE_CHECK(consumed > 0);
+    for (size_t r = 0; r < sink.count; r++) {
+      buffer[r].frame += i;
+    }
+    records.insert(records.end(), buffer.begin(), buffer.begin() + sink.count);
+    i += consumed;
+  }
+}
+
+static void testBatch(const uint8_t (*frames)[8], const size_t n) {
+  Records expected;
+  decodeFrames(frames, n, expected);
+
+  IDriveDecoderCore decoder;
+  Records           records;
+  decodeBatches(decoder, frames, n, records);
+
+  IDRIVE_CHECK(sameRecords(expected, records));
+}
+
+// IDRIVEDECODER_EVENT of every event of the inputs in the mask
+static uint64_t inputEvents(const uint16_t inputs) {
+  static const unsigned char pressIds[] = {
+    IDRIVEDECODER_CENTER, IDRIVEDECODER_LEFT, IDRIVEDECODER_UP,     IDRIVEDECODER_RIGHT,
+    IDRIVEDECODER_DOWN,   IDRIVEDECODER_MENU, IDRIVEDECODER_BACK,   IDRIVEDECODER_COM,
+    IDRIVEDECODER_OPTION, IDRIVEDECODER_MEDIA, IDRIVEDECODER_NAV,   IDRIVEDECODER_MAP
+  };
+  uint64_t mask = 0;
+
+  for (unsigned char i = 0; i < sizeof(pressIds); i++) {
+    if (inputs >> i & 1) {
+      mask |= (uint64_t)7 << pressIds[i];
+    }
+  }
+
+  return mask;
+}
+
+template<uint16_t Inputs>
+static void testInputs(const uint8_t (*frames)[8], const size_t n) {
+  auto              subset = makeIDriveDecoder<Inputs>(onSwitch, onRotary);
+  IDriveDecoderCore full;
+  const uint64_t    enabled = inputEvents(Inputs);
+
+  for (size_t i = 0; i < n; i++) {
+    IDriveEvents expected;
+    IDriveEvents events;
+
+    full.decode(frames[i], expected);
+    subset.decode(frames[i], events);
+
+    IDRIVE_CHECK(events.mask == (expected.mask & enabled));
+    IDRIVE_CHECK(events.rotary == expected.rotary);
+    if (events.mask != (expected.mask & enabled) || events.rotary != expected.rotary) {
+      return;
+    }
+  }
+
+  // the other inputs never set their state bits
+  IDriveDecoderState state;
+  subset.saveState(state);
+  IDRIVE_CHECK(!(IDriveDecoderCore::held(state.switches) & ~enabled));
+
+  // decodeBatch of the subset decoder, too
+  Records all;
+  Records expected;
+  decodeFrames(frames, n, all);
+  for (size_t r = 0; r < all.size(); r++) {
+    if (all[r].eventId == IDRIVEDECODER_ROTARY || (enabled & IDRIVEDECODER_EVENT(all[r].eventId))) {
+      expected.push_back(all[r]);
+    }
+  }
+
+  auto    batched = makeIDriveDecoder<Inputs>(onSwitch, onRotary);
+  Records records;
+  decodeBatches(batched, frames, n, records);
+  IDRIVE_CHECK(sameRecords(expected, records));
+
+  batched.saveState(state);
+  IDRIVE_CHECK(!(IDriveDecoderCore::held(state.switches) & ~enabled));
+}
+
+static void testStats(void) {
+  auto          decoder = makeIDriveDecoder<IDriveDecoderStats>(onSwitch, onRotary);
+  unsigned char data[8] = { 0x50, 0x34, 0x12, 0x00, 0x00, 0x00, 0xc0, 0xf8 };
+
+  // starting mid-stream is not a gap
+  for (int i = 0; i < 10; i++) {
+    decoder.decode(data);
+    data[0]++;
+  }
+  IDRIVE_CHECK(decoder.stats().gaps == 0);
+  IDRIVE_CHECK(decoder.stats().lost == 0);
+
+  data[0] += 3;
+  decoder.decode(data);
+  IDRIVE_CHECK(decoder.stats().gaps == 1);
+  IDRIVE_CHECK(decoder.stats().lost == 3);
+}
+
+// decodeBatch counts every message like decode does
+static void testStatsBatch(const uint8_t (*frames)[8], const size_t n) {
+  auto single  = makeIDriveDecoder<IDriveDecoderStats>(onSwitch, onRotary);
+  auto batched = makeIDriveDecoder<IDriveDecoderStats>(onSwitch, onRotary);
+
+  for (size_t i = 0; i < n; i++) {
+    IDriveEvents events;
+    single.decode(frames[i], events);
+  }
+
+  Records records;
+  decodeBatches(batched, frames, n, records);
+
+  IDRIVE_CHECK(batched.stats().frames == n);
+  IDRIVE_CHECK(!memcmp(&single.stats(), &batched.stats(), sizeof(IDriveDecoderStats)));
+}
+
+int main() {
+  std::vector<uint8_t> buffer(trafficFrames * 8);
+  uint8_t (*frames)[8] = reinterpret_cast<uint8_t (*)[8]>(buffer.data());
+
+  idriveRandomTraffic(frames, trafficFrames, 0x25b);
+
+  testEncoderRoundTrip();
+  testLadderOrder(frames, trafficFrames);
+  testBatch(frames, trafficFrames);
+  testInputs<IDRIVEDECODER_INPUT_KNOB | IDRIVEDECODER_INPUT_MENU>(frames, trafficFrames);
+  testInputs<IDRIVEDECODER_INPUT_CENTER | IDRIVEDECODER_INPUT_DOWN>(frames, trafficFrames);
+  testInputs<IDRIVEDECODER_INPUT_COM | IDRIVEDECODER_INPUT_OPTION | IDRIVEDECODER_INPUT_NAV>(frames, trafficFrames);
+  testInputs<IDRIVEDECODER_INPUT_MAP>(frames, trafficFrames);
+  testStats();
+  testStatsBatch(frames, trafficFrames);
+
+  return idriveTestResult();
+}
@@ -0,0 +1,86 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveEventQueue: order, a full queue and the dropped counter */
+
+#include <IDriveEventQueue.h>
+
+#include "IDriveTest.h"
+
+static void testFull(void) {
+  IDriveEventQueue<4> queue;
+  IDriveEvent         event = { 0, 0 };
+
+  IDRIVE_CHECK(!queue.pop(event));
+
+  // head and tail wrap at 256 while the queue fills and drains
+  for (int round = 0; round < 100; round++) {
+    for (int i = 0; i < 4; i++) {
+      IDRIVE_CHECK(queue.push(IDRIVEDECODER_CENTER + i, round));
+    }
+    IDRIVE_CHECK(queue.size() == 4);
+
+    IDRIVE_CHECK(!queue.push(IDRIVEDECODER_MENU, 0));
+    IDRIVE_CHECK(queue.dropped == round + 1);
+
+    for (int i = 0; i < 4; i++) {
+      IDRIVE_CHECK(queue.pop(event));
+      IDRIVE_CHECK(event.eventId == IDRIVEDECODER_CENTER + i && event.value == round);
+    }
+    IDRIVE_CHECK(!queue.pop(event));
+    IDRIVE_CHECK(queue.size() == 0);
+  }
+
+  // the counter stops at 255 instead of wrapping to 0
+  for (int i = 0; i < 4; i++) {
+    queue.push(IDRIVEDECODER_CENTER, 0);
+  }
+  for (int i = 0; i < 300; i++) {
+    IDRIVE_CHECK(!queue.push(IDRIVEDECODER_MENU, 0));
+  }
+  IDRIVE_CHECK(queue.dropped == 0xff);
+
+  // room again after a pop
+  IDRIVE_CHECK(queue.pop(event));
+  IDRIVE_CHECK(queue.push(IDRIVEDECODER_MENU, 0));
+}
+
+/* as both handlers of a decoder, the events come out as decode fired them */
+static void testHandlers(void) {
+  typedef IDriveEventQueue<8> Queue;
+  Queue                              queue;
+  BasicIDriveDecoder<Queue&, Queue&> decoder(queue, queue);
+
+  // menu pressed and the rotary moved by 3 from its initial position
+  const unsigned char data[8] = { 0x01, 0x02, 0x80, 0x00, 0x04, 0x00, 0xc0, 0xf8 };
+  decoder.decode(data);
+
+  IDriveEvent event;
+  IDRIVE_CHECK(queue.size() == 2);
+  IDRIVE_CHECK(queue.pop(event) && event.eventId == IDRIVEDECODER_ROTARY && event.value == 3);
+  IDRIVE_CHECK(queue.pop(event) && event.eventId == IDRIVEDECODER_MENU && event.value == 0);
+  IDRIVE_CHECK(queue.dropped == 0);
+}
+
+int main() {
+  testFull();
+  testHandlers();
+
+  return idriveTestResult();
+}
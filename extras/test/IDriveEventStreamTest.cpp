@@ -0,0 +1,114 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* round trip of random events through IDriveStreamEncoder and
+ * IDriveStreamDecoder, and the decoder on corrupted streams */
+
+#include <IDriveEventStream.h>
+
+#include "IDriveTest.h"
+
+#include <vector>
+
+static const size_t streamEvents = 200000;
+
+struct Event {
+  unsigned char eventId;
+  short         value;
+  uint32_t      time;
+};
+
+static void testRoundTrip(void) {
+  IDriveTestRandom     random(0x5717);
+  IDriveStreamEncoder  encoder;
+  std::vector<Event>   events(streamEvents);
+  std::vector<uint8_t> bytes;
+  unsigned long        now   = 1000;
+  unsigned long        start = 0;
+
+  for (size_t i = 0; i < streamEvents; i++) {
+    Event &event = events[i];
+
+    // mostly short gaps, some in the same tick and some long ones
+    const uint32_t kind = random.below(16);
+    now += kind < 4 ? 0 : kind < 14 ? random.below(200) : random.next() >> 8;
+
+    // the encoder syncs before its first event, times count from there
+    if (!i) {
+      start = now;
+    }
+
+    event.eventId = random.below(IDRIVEDECODER_OPTION_REL + 1);
+    event.value   = event.eventId == IDRIVEDECODER_ROTARY ? (short)random.next() : 0;
+    event.time    = now - start;
+
+    unsigned char buffer[IDRIVESTREAM_MAX_BYTES];
+    const unsigned char n = encoder.encode(event.eventId, event.value, now, buffer);
+
+    IDRIVE_CHECK(n <= IDRIVESTREAM_MAX_BYTES);
+    bytes.insert(bytes.end(), buffer, buffer + n);
+  }
+
+  IDriveStreamDecoder decoder;
+  size_t              decoded = 0;
+
+  for (size_t i = 0; i < bytes.size(); i++) {
+    if (!decoder.push(bytes[i])) {
+      continue;
+    }
+
+    IDRIVE_CHECK(decoded < streamEvents);
+    if (decoded == streamEvents) {
+      break;
+    }
+
+    const Event &event = events[decoded++];
+    IDRIVE_CHECK(decoder.eventId == event.eventId);
+    IDRIVE_CHECK(decoder.value == event.value);
+    IDRIVE_CHECK(decoder.time == event.time);
+  }
+
+  IDRIVE_CHECK(decoded == streamEvents);
+  IDRIVE_CHECK(decoder.errors == 0);
+}
+
+static void testCorrupted(void) {
+  IDriveStreamDecoder decoder;
+
+  // sync, unknown id 63 with a delta byte, unknown id 37, then a center press
+  const uint8_t bytes[] = { IDRIVESTREAM_SYNC, 0xff & ~0x40, 0x01, 0x80 | 37, 0x80 | IDRIVEDECODER_CENTER };
+  unsigned      events = 0;
+
+  for (size_t i = 0; i < sizeof(bytes); i++) {
+    if (decoder.push(bytes[i])) {
+      events++;
+      IDRIVE_CHECK(decoder.eventId == IDRIVEDECODER_CENTER);
+    }
+  }
+
+  IDRIVE_CHECK(events == 1);
+  IDRIVE_CHECK(decoder.errors == 3);
+}
+
+int main() {
+  testRoundTrip();
+  testCorrupted();
+
+  return idriveTestResult();
+}
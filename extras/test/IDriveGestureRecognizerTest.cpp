@@ -0,0 +1,144 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveGestureRecognizer on hand-made event sequences */
+
+#include <IDriveGestureRecognizer.h>
+
+#include "IDriveTest.h"
+
+static const IDriveGesture gestures[] = {
+  { IDRIVEGESTURE_DOUBLE, IDRIVEDECODER_CENTER, 0,                    1 },
+  { IDRIVEGESTURE_CHORD,  IDRIVEDECODER_BACK,   IDRIVEDECODER_OPTION, 2 },
+  { IDRIVEGESTURE_TURN,   IDRIVEDECODER_MENU,   0,                    3 },
+  { IDRIVEGESTURE_CHORD,  IDRIVEDECODER_MENU,   IDRIVEDECODER_BACK,   4 },
+};
+
+struct Recorder {
+  unsigned char ids[8];
+  short         values[8];
+  size_t        count;
+
+  void operator()(const unsigned char id, const short value) {
+    if (count < 8) {
+      ids[count]    = id;
+      values[count] = value;
+    }
+    count++;
+  }
+};
+
+static Recorder recorder;
+
+/* the gestures one message completes, 0 when none, the ids as decimal digits otherwise */
+static unsigned update(IDriveGestureRecognizer& recognizer, const uint64_t mask, const unsigned long now, const short rotary = 0) {
+  IDriveEvents events = { mask, rotary };
+
+  recorder.count = 0;
+  recognizer.update(events, now, recorder);
+
+  unsigned ids = 0;
+  for (size_t i = 0; i < recorder.count && i < 8; i++) {
+    ids = ids * 10 + recorder.ids[i];
+  }
+  return ids;
+}
+
+#define E(eventId) IDRIVEDECODER_EVENT(IDRIVEDECODER_##eventId)
+
+static void testDouble(void) {
+  IDriveGestureRecognizer recognizer(gestures, 4, 400);
+
+  IDRIVE_CHECK(update(recognizer, E(CENTER), 1000) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER_REL), 1100) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER), 1399) == 1);
+  IDRIVE_CHECK(recorder.values[0] == 0);
+
+  // the second press of a double does not start the next one
+  IDRIVE_CHECK(update(recognizer, E(CENTER_REL), 1450) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER), 1500) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER_REL), 1550) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER), 1600) == 1);
+
+  // long press of a held button is no second press
+  IDRIVE_CHECK(update(recognizer, E(CENTER_REL), 2000) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER), 2100) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER_EXT), 2200) == 0);
+
+  // too slow, the late press starts the next double instead
+  IDRIVE_CHECK(update(recognizer, E(CENTER_REL), 2300) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER), 2500) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER_REL), 2600) == 0);
+  IDRIVE_CHECK(update(recognizer, E(CENTER), 2899) == 1);
+  IDRIVE_CHECK(update(recognizer, E(CENTER_REL), 2950) == 0);
+}
+
+static void testChordAndTurn(void) {
+  IDriveGestureRecognizer recognizer(gestures, 4, 400);
+
+  // either order, and both in the same message
+  IDRIVE_CHECK(update(recognizer, E(BACK), 0) == 0);
+  IDRIVE_CHECK(update(recognizer, E(OPTION), 10) == 2);
+  IDRIVE_CHECK(update(recognizer, E(BACK_REL), 20) == 0);
+  IDRIVE_CHECK(update(recognizer, E(BACK), 30) == 2);
+  IDRIVE_CHECK(update(recognizer, E(BACK_EXT) | E(OPTION_EXT), 40) == 0);
+  IDRIVE_CHECK(update(recognizer, E(BACK_REL) | E(OPTION_REL), 50) == 0);
+  IDRIVE_CHECK(update(recognizer, E(BACK) | E(OPTION), 60) == 2);
+  IDRIVE_CHECK(update(recognizer, E(BACK_REL) | E(OPTION_REL), 70) == 0);
+
+  // turning without menu held is nothing
+  IDRIVE_CHECK(update(recognizer, 0, 100, 5) == 0);
+  IDRIVE_CHECK(update(recognizer, E(MENU), 110) == 0);
+  IDRIVE_CHECK(update(recognizer, 0, 120, -7) == 3);
+  IDRIVE_CHECK(recorder.values[0] == -7);
+
+  // one message completing two gestures reports them in table order
+  IDRIVE_CHECK(update(recognizer, E(BACK), 130, 2) == 34);
+  IDRIVE_CHECK(recorder.values[0] == 2 && recorder.values[1] == 0);
+  IDRIVE_CHECK(recognizer.buttons() == (E(MENU) | E(BACK)));
+
+  IDRIVE_CHECK(update(recognizer, E(MENU_REL) | E(BACK_REL), 140) == 0);
+  IDRIVE_CHECK(update(recognizer, 0, 150, 1) == 0);
+  IDRIVE_CHECK(recognizer.buttons() == 0);
+}
+
+/* after a reset of the decoder the held buttons come from its state */
+static void testSync(void) {
+  IDriveGestureRecognizer recognizer(gestures, 4, 400);
+  IDriveDecoderCore       decoder;
+  IDriveEvents            events;
+  IDriveDecoderState      state;
+
+  // menu pressed
+  const unsigned char data[8] = { 0x01, 0xff, 0x7f, 0x00, 0x04, 0x00, 0xc0, 0xf8 };
+  decoder.decode(data, events);
+  decoder.saveState(state);
+
+  recognizer.sync(state);
+  IDRIVE_CHECK(recognizer.buttons() == E(MENU));
+  IDRIVE_CHECK(update(recognizer, 0, 0, 3) == 3);
+}
+
+int main() {
+  testDouble();
+  testChordAndTurn();
+  testSync();
+
+  return idriveTestResult();
+}
@@ -0,0 +1,134 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveInputTimer: repeats across turns of the wheel, and the release of
+ * held inputs once the CAN-messages stop */
+
+#include <IDriveInputTimer.h>
+
+#include "IDriveTest.h"
+
+struct Recorder {
+  unsigned char eventIds[64];
+  unsigned long times[64];
+  size_t        count;
+  unsigned long now;
+
+  Recorder():count(0),now(0) {
+  }
+
+  void operator()(const unsigned char eventId) {
+    if (count < 64) {
+      eventIds[count] = eventId;
+      times[count]    = now;
+    }
+    count++;
+  }
+};
+
+static void update(IDriveInputTimer& timer, const uint64_t mask, const unsigned long now) {
+  IDriveEvents events = { mask, 0 };
+  timer.update(events, now);
+}
+
+static bool tick(IDriveInputTimer& timer, Recorder& recorder, const unsigned long now) {
+  recorder.now = now;
+  return timer.tick(now, recorder);
+}
+
+/* the wheel turns every 16 * 10 ticks, the first repeat is 3 turns ahead */
+static void testRepeatAndTimeout(void) {
+  IDriveInputTimer timer(IDRIVEDECODER_EVENT(IDRIVEDECODER_UP) | IDRIVEDECODER_EVENT(IDRIVEDECODER_DOWN), 500, 100, 1000, 10);
+  Recorder         recorder;
+
+  // up held with a message every 20 ticks, released at 810
+  update(timer, IDRIVEDECODER_EVENT(IDRIVEDECODER_UP), 0);
+  IDRIVE_CHECK(timer.buttons() == IDRIVEDECODER_EVENT(IDRIVEDECODER_UP));
+
+  for (unsigned long now = 20; now <= 1000; now += 20) {
+    update(timer, now == 300 ? IDRIVEDECODER_EVENT(IDRIVEDECODER_UP_EXT) : now == 820 ? IDRIVEDECODER_EVENT(IDRIVEDECODER_UP_REL) : 0, now);
+    IDRIVE_CHECK(!tick(timer, recorder, now));
+  }
+
+  IDRIVE_CHECK(recorder.count == 4);
+  for (size_t i = 0; i < 4 && i < recorder.count; i++) {
+    IDRIVE_CHECK(recorder.eventIds[i] == IDRIVEDECODER_UP);
+    IDRIVE_CHECK(recorder.times[i] == 500 + 100 * i);
+  }
+  IDRIVE_CHECK(timer.buttons() == 0);
+
+  // down repeats, menu does not, then the messages stop after 1000
+  recorder.count = 0;
+  update(timer, IDRIVEDECODER_EVENT(IDRIVEDECODER_DOWN) | IDRIVEDECODER_EVENT(IDRIVEDECODER_MENU), 1000);
+
+  unsigned long timedOut = 0;
+  for (unsigned long now = 1010; now <= 3000 && !timedOut; now += 10) {
+    if (tick(timer, recorder, now)) {
+      timedOut = now;
+    }
+  }
+
+  IDRIVE_CHECK(timedOut == 2000);
+
+  // repeats at 1500 .. 1900, then the releases instead of the one at 2000
+  IDRIVE_CHECK(recorder.count == 7);
+  for (size_t i = 0; i < 5 && i < recorder.count; i++) {
+    IDRIVE_CHECK(recorder.eventIds[i] == IDRIVEDECODER_DOWN);
+    IDRIVE_CHECK(recorder.times[i] == 1500 + 100 * i);
+  }
+  IDRIVE_CHECK(recorder.count == 7 && recorder.eventIds[5] == IDRIVEDECODER_DOWN_REL && recorder.eventIds[6] == IDRIVEDECODER_MENU_REL);
+  IDRIVE_CHECK(timer.buttons() == 0);
+
+  // nothing is left to fire
+  recorder.count = 0;
+  for (unsigned long now = 2010; now <= 4000; now += 10) {
+    IDRIVE_CHECK(!tick(timer, recorder, now));
+  }
+  IDRIVE_CHECK(recorder.count == 0);
+}
+
+/* a tick that comes late fires once and keeps the rate from there */
+static void testLateTick(void) {
+  IDriveInputTimer timer(IDRIVEDECODER_EVENT(IDRIVEDECODER_CENTER), 200, 50, 0, 8);
+  Recorder         recorder;
+
+  update(timer, IDRIVEDECODER_EVENT(IDRIVEDECODER_CENTER), 1000);
+
+  IDRIVE_CHECK(!tick(timer, recorder, 1100));
+  IDRIVE_CHECK(recorder.count == 0);
+
+  IDRIVE_CHECK(!tick(timer, recorder, 1777));
+  IDRIVE_CHECK(recorder.count == 1);
+
+  IDRIVE_CHECK(!tick(timer, recorder, 1826));
+  IDRIVE_CHECK(recorder.count == 1);
+  IDRIVE_CHECK(!tick(timer, recorder, 1827));
+  IDRIVE_CHECK(recorder.count == 2);
+
+  // without a timeout held inputs stay held however long the messages stop
+  IDRIVE_CHECK(!tick(timer, recorder, 100000));
+  IDRIVE_CHECK(timer.buttons() == IDRIVEDECODER_EVENT(IDRIVEDECODER_CENTER));
+}
+
+int main() {
+  testRepeatAndTimeout();
+  testLateTick();
+
+  return idriveTestResult();
+}
@@ -0,0 +1,150 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveHistogram buckets, percentiles and format, and IDriveLatencyTrace
+ * on a decoder with a clock that steps by a fixed amount */
+
+#include <IDriveLatencyTrace.h>
+
+#include "IDriveTest.h"
+
+static void testBuckets(void) {
+  IDriveHistogram histogram;
+
+  histogram.add(0);
+  histogram.add(1);
+  histogram.add(2);
+  histogram.add(3);
+  histogram.add(4);
+  histogram.add(0x7fffffff);
+  histogram.add(0x80000000);
+  histogram.add(0xffffffff);
+
+  IDRIVE_CHECK(histogram.counts[0] == 1);
+  IDRIVE_CHECK(histogram.counts[1] == 1);
+  IDRIVE_CHECK(histogram.counts[2] == 2);
+  IDRIVE_CHECK(histogram.counts[3] == 1);
+  IDRIVE_CHECK(histogram.counts[31] == 1);
+  IDRIVE_CHECK(histogram.counts[32] == 2);
+  IDRIVE_CHECK(histogram.count() == 8);
+
+  histogram.clear();
+  IDRIVE_CHECK(histogram.count() == 0);
+}
+
+static void testPercentile(void) {
+  IDriveHistogram histogram;
+
+  IDRIVE_CHECK(histogram.percentile(990) == 0);
+
+  // 989 in bucket 4 (8 .. 15), 10 in bucket 7 (64 .. 127), 1 in bucket 11
+  for (int i = 0; i < 989; i++) {
+    histogram.add(10);
+  }
+  for (int i = 0; i < 10; i++) {
+    histogram.add(100);
+  }
+  histogram.add(1500);
+
+  IDRIVE_CHECK(histogram.percentile(0) == 15);
+  IDRIVE_CHECK(histogram.percentile(500) == 15);
+  IDRIVE_CHECK(histogram.percentile(989) == 15);
+  IDRIVE_CHECK(histogram.percentile(990) == 127);
+  IDRIVE_CHECK(histogram.percentile(999) == 127);
+  IDRIVE_CHECK(histogram.percentile(1000) == 2047);
+
+  // rounds the rank up, p50 of 3 is the second
+  IDriveHistogram small;
+  small.add(0);
+  small.add(5);
+  small.add(600);
+  IDRIVE_CHECK(small.percentile(500) == 7);
+  IDRIVE_CHECK(small.percentile(1) == 0);
+}
+
+static void testFormat(void) {
+  IDriveHistogram histogram;
+  char            buffer[64];
+
+  IDRIVE_CHECK(histogram.format(buffer, sizeof(buffer)) == 0);
+  IDRIVE_CHECK(!strcmp(buffer, ""));
+
+  histogram.add(0);
+  histogram.add(10);
+  histogram.add(12);
+  histogram.add(0xffffffff);
+
+  IDRIVE_CHECK(histogram.format(buffer, sizeof(buffer)) == 12);
+  IDRIVE_CHECK(!strcmp(buffer, "0:1 4:2 32:1"));
+
+  // like snprintf: the full length, the buffer holds what fits
+  memset(buffer, 'x', sizeof(buffer));
+  IDRIVE_CHECK(histogram.format(buffer, 6) == 12);
+  IDRIVE_CHECK(!strcmp(buffer, "0:1 4"));
+  IDRIVE_CHECK(buffer[6] == 'x');
+
+  IDRIVE_CHECK(histogram.format(0, 0) == 12);
+}
+
+struct StepClock {
+  static uint32_t ticks;
+
+  static inline uint32_t now(void) {
+    return ticks += 5;
+  }
+};
+
+uint32_t StepClock::ticks = 0xfffffff0;
+
+static void onSwitch(const unsigned char) {
+}
+
+static void onRotary(const short) {
+}
+
+static void testTrace(void) {
+  typedef BasicIDriveDecoder<void (&)(const unsigned char), void (&)(const short), IDriveNoStats, IDriveLatencyTrace<StepClock> > Decoder;
+  Decoder decoder(onSwitch, onRotary);
+
+  // menu pressed and the rotary moved: two callbacks, then an idle repeat
+  const unsigned char active[8] = { 0x01, 0x02, 0x80, 0x00, 0x04, 0x00, 0xc0, 0xf8 };
+  const unsigned char idle[8]   = { 0x02, 0x02, 0x80, 0x00, 0x04, 0x00, 0xc0, 0xf8 };
+  decoder.decode(active);
+  decoder.decode(idle);
+
+  // 5 ticks each, across the wrap of the clock, bucket 3 (4 .. 7)
+  IDRIVE_CHECK(decoder.trace().decode.counts[3] == 2);
+  IDRIVE_CHECK(decoder.trace().handler.counts[3] == 2);
+
+  // 15 ticks for the message with events (8 .. 15), none for the idle one
+  IDRIVE_CHECK(decoder.trace().total.count() == 1);
+  IDRIVE_CHECK(decoder.trace().total.counts[4] == 1);
+
+  decoder.trace().clear();
+  IDRIVE_CHECK(decoder.trace().decode.count() == 0);
+}
+
+int main() {
+  testBuckets();
+  testPercentile();
+  testFormat();
+  testTrace();
+
+  return idriveTestResult();
+}
@@ -0,0 +1,135 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveLogReplay on candump and ASC logs with lines it has to skip */
+
+#include "IDriveLogReplay.h"
+#include "IDriveTest.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static const unsigned char expected[][8] = {
+  { 0x01, 0xff, 0x7f, 0x00, 0x04, 0x00, 0xc0, 0xf8 },
+  { 0x02, 0x00, 0x80, 0x01, 0x00, 0x00, 0xc1, 0xf8 },
+  { 0x03, 0xab, 0xcd, 0xef, 0x12, 0x34, 0x56, 0x78 },
+};
+
+/* writes text to a temporary file and replays it, the file is removed again */
+static size_t replay(const char* text, unsigned char (*data)[8], uint64_t* timestamps, const size_t n, size_t& lines) {
+  char path[] = "/tmp/idrive-replay-XXXXXX";
+  const int fd = mkstemp(path);
+  IDRIVE_CHECK(fd >= 0);
+
+  const size_t length = strlen(text);
+  IDRIVE_CHECK(write(fd, text, length) == (ssize_t)length);
+  close(fd);
+
+  IDriveLogReplay log;
+  IDRIVE_CHECK(log.open(path));
+  unlink(path);
+  IDRIVE_CHECK(log.size() == length);
+
+  size_t count = 0;
+  unsigned char frame[8];
+  uint64_t      timestamp;
+  while (log.next(frame, timestamp)) {
+    if (count < n) {
+      memcpy(data[count], frame, sizeof(frame));
+      timestamps[count] = timestamp;
+    }
+    count++;
+  }
+
+  // stays at the end
+  IDRIVE_CHECK(!log.next(frame, timestamp));
+  IDRIVE_CHECK(log.messages == count);
+
+  lines = log.lines;
+  return count;
+}
+
+static void testCandump(void) {
+  const char *text =
+    "(1436509052.249713) can0 25B#01FF7F000400C0F8\n"
+    "(1436509052.250000) can0 0BF#0011223344556677\n"      // other id
+    "(1436509052.250100) can0 0000025B#0011223344556677\n" // extended id
+    "\n"
+    "(1436509052.250200) can0 25B#0011\n"                  // short
+    "(1436509052.250300) can0 25B#01FF7F0004ZZC0F8\n"      // not hex
+    "  (1436509052.260713) vcan1 25b#020080010000C1F8\n"
+    "(1436509053.5) can0 25B#03ABCDEF12345678";            // no newline
+
+  unsigned char data[4][8];
+  uint64_t      timestamps[4];
+  size_t        lines;
+
+  IDRIVE_CHECK(replay(text, data, timestamps, 4, lines) == 3);
+  IDRIVE_CHECK(lines == 8);
+  IDRIVE_CHECK(!memcmp(data, expected, sizeof(expected)));
+  IDRIVE_CHECK(timestamps[0] == 1436509052249713000ull);
+  IDRIVE_CHECK(timestamps[1] == 1436509052260713000ull);
+  IDRIVE_CHECK(timestamps[2] == 1436509053500000000ull);
+}
+
+static void testAsc(void) {
+  const char *text =
+    "date Fri Jul 10 08:17:32.249 am 2015\r\n"
+    "base hex  timestamps absolute\r\n"
+    "   0.000000 Start of measurement\r\n"
+    "   12.345678 1  25B             Rx   d 8 01 FF 7F 00 04 00 C0 F8\r\n"
+    "   12.346000 1  25B             Rx   r\r\n"                          // remote frame
+    "   12.346500 1  25Bx            Rx   d 8 00 11 22 33 44 55 66 77\r\n" // extended id
+    "   12.347000 1  0BF             Rx   d 8 00 11 22 33 44 55 66 77\r\n"
+    "   12.348000 1  25B             Rx   d 2 00 11\r\n"                  // short
+    "   12.355678 2  25B             Tx   d 8 02 00 80 01 00 00 C1 F8\r\n"
+    "   13.000001 1  25B             Rx   d 8 03 ab cd ef 12 34 56 78\r\n"
+    "End TriggerBlock\r\n";
+
+  unsigned char data[4][8];
+  uint64_t      timestamps[4];
+  size_t        lines;
+
+  IDRIVE_CHECK(replay(text, data, timestamps, 4, lines) == 3);
+  IDRIVE_CHECK(lines == 11);
+  IDRIVE_CHECK(!memcmp(data, expected, sizeof(expected)));
+  IDRIVE_CHECK(timestamps[0] == 12345678000ull);
+  IDRIVE_CHECK(timestamps[1] == 12355678000ull);
+  IDRIVE_CHECK(timestamps[2] == 13000001000ull);
+}
+
+static void testEmpty(void) {
+  unsigned char data[1][8];
+  uint64_t      timestamps[1];
+  size_t        lines;
+
+  IDRIVE_CHECK(replay("", data, timestamps, 1, lines) == 0);
+  IDRIVE_CHECK(lines == 0);
+
+  IDriveLogReplay log;
+  IDRIVE_CHECK(!log.open("/nonexistent/idrive.log"));
+}
+
+int main() {
+  testCandump();
+  testAsc();
+  testEmpty();
+
+  return idriveTestResult();
+}
@@ -0,0 +1,83 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveParallelDecoder has to produce the records and the final state of a
+ * single decodeBatch over the same log */
+
+#include "IDriveParallelDecoder.h"
+#include "IDriveTest.h"
+
+#include <vector>
+
+static const size_t logFrames = 300000;
+
+static void sequential(const uint8_t (*frames)[8], const size_t n, IDriveDecoderCore& decoder, std::vector<IDriveEventRecord>& records) {
+  size_t i = 0;
+
+  while (i < n) {
+    const size_t offset = records.size();
+    records.resize(offset + 4096);
+
+    IDriveEventSink sink = { records.data() + offset, 4096, 0 };
+    const size_t consumed = decoder.decodeBatch(frames + i, n - i, sink);
+
+    for (size_t r = 0; r < sink.count; r++) {
+      sink.records[r].frame += i;
+    }
+
+    records.resize(offset + sink.count);
+    i += consumed;
+  }
+}
+
+static void check(const uint8_t (*frames)[8], const size_t n, const unsigned threads) {
+  IDriveDecoderCore              decoder;
+  std::vector<IDriveEventRecord> expected;
+  sequential(frames, n, decoder, expected);
+
+  IDriveParallelDecoder          parallel(threads);
+  std::vector<IDriveEventRecord> records;
+  parallel.decode(frames, n, records);
+
+  IDRIVE_CHECK(records.size() == expected.size());
+
+  bool same = records.size() == expected.size();
+  for (size_t r = 0; same && r < records.size(); r++) {
+    same = records[r].frame == expected[r].frame && records[r].value == expected[r].value && records[r].eventId == expected[r].eventId;
+  }
+  IDRIVE_CHECK(same);
+
+  IDriveDecoderState a, b;
+  decoder.saveState(a);
+  parallel.state().saveState(b);
+  IDRIVE_CHECK(!memcmp(&a, &b, sizeof(a)));
+}
+
+int main() {
+  std::vector<uint8_t> buffer(logFrames * 8);
+  uint8_t (*frames)[8] = reinterpret_cast<uint8_t (*)[8]>(buffer.data());
+
+  idriveRandomTraffic(frames, logFrames, 0xbf);
+
+  check(frames, logFrames, 1);
+  check(frames, logFrames, 4);
+  check(frames, logFrames, 7);
+
+  return idriveTestResult();
+}
@@ -0,0 +1,107 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveRotaryCoalescer: when windows are reported, and their total and
+ * velocity */
+
+#include <IDriveRotaryCoalescer.h>
+
+#include "IDriveTest.h"
+
+static bool update(IDriveRotaryCoalescer& coalescer, const short rotary, const unsigned long now, const uint64_t mask = 0) {
+  IDriveEvents events = { mask, rotary };
+  return coalescer.update(events, now);
+}
+
+static void testFrames(void) {
+  IDriveRotaryCoalescer coalescer(3, 0);
+
+  // no window opens before the rotary moves
+  IDRIVE_CHECK(!update(coalescer, 0, 500));
+
+  // the first window has no message before it, the velocity is measured
+  // from its own first message
+  IDRIVE_CHECK(!update(coalescer, 2, 1000));
+  IDRIVE_CHECK(!update(coalescer, 3, 1010));
+  IDRIVE_CHECK(update(coalescer, 5, 1020));
+  IDRIVE_CHECK(coalescer.total == 10);
+  IDRIVE_CHECK(coalescer.velocity == 400);
+
+  IDRIVE_CHECK(!update(coalescer, -1, 1030));
+  IDRIVE_CHECK(!update(coalescer, -1, 1040));
+  IDRIVE_CHECK(update(coalescer, -1, 1050));
+  IDRIVE_CHECK(coalescer.total == -3);
+  IDRIVE_CHECK(coalescer.velocity == -100);
+
+  // deltas adding up to 0 are not reported
+  IDRIVE_CHECK(!update(coalescer, 4, 1060));
+  IDRIVE_CHECK(!update(coalescer, -2, 1070));
+  IDRIVE_CHECK(!update(coalescer, -2, 1080));
+  IDRIVE_CHECK(!coalescer.flush());
+}
+
+static void testWindow(void) {
+  IDriveRotaryCoalescer coalescer(0, 50);
+
+  IDRIVE_CHECK(!update(coalescer, 1, 100));
+  IDRIVE_CHECK(!coalescer.poll(149));
+
+  // a single message is one timestamp, there is no velocity yet
+  IDRIVE_CHECK(coalescer.poll(150));
+  IDRIVE_CHECK(coalescer.total == 1);
+  IDRIVE_CHECK(coalescer.velocity == 0);
+  IDRIVE_CHECK(!coalescer.poll(200));
+
+  // messages without movement neither open nor stretch the window
+  IDRIVE_CHECK(!update(coalescer, 0, 300));
+  IDRIVE_CHECK(!update(coalescer, 3, 400));
+  IDRIVE_CHECK(!update(coalescer, 3, 420));
+  IDRIVE_CHECK(!update(coalescer, 0, 440));
+  IDRIVE_CHECK(update(coalescer, 0, 450));
+  IDRIVE_CHECK(coalescer.total == 6);
+  IDRIVE_CHECK(coalescer.velocity == 150);
+}
+
+static void testSwitch(void) {
+  IDriveRotaryCoalescer coalescer(0, 0);
+
+  // a switch event alone does not report anything
+  IDRIVE_CHECK(!update(coalescer, 0, 0, IDRIVEDECODER_EVENT(IDRIVEDECODER_MENU)));
+
+  IDRIVE_CHECK(!update(coalescer, 7, 10));
+  IDRIVE_CHECK(!update(coalescer, 7, 20));
+  IDRIVE_CHECK(update(coalescer, 0, 25, IDRIVEDECODER_EVENT(IDRIVEDECODER_CENTER)));
+  IDRIVE_CHECK(coalescer.total == 14);
+  IDRIVE_CHECK(coalescer.velocity == 700);
+
+  IDRIVE_CHECK(!update(coalescer, -2, 30));
+  IDRIVE_CHECK(!update(coalescer, -2, 58));
+  IDRIVE_CHECK(coalescer.flush());
+  IDRIVE_CHECK(coalescer.total == -4);
+  IDRIVE_CHECK(coalescer.velocity == -71);
+  IDRIVE_CHECK(!coalescer.flush());
+}
+
+int main() {
+  testFrames();
+  testWindow();
+  testSwitch();
+
+  return idriveTestResult();
+}
@@ -0,0 +1,144 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveStatePublisher: the published position and inputs, and snapshots
+ * that stay consistent while another thread publishes */
+
+#include "IDriveStatePublisher.h"
+#include "IDriveTest.h"
+
+#include <IDriveEncoder.h>
+
+#include <atomic>
+#include <thread>
+
+static const unsigned long publishes = 1000000;
+
+static void testPosition(void) {
+  IDriveDecoderCore    decoder;
+  IDriveStatePublisher publisher;
+  IDriveSnapshot       snapshot;
+  IDriveEvents         events;
+  unsigned char        data[8] = { 0x50, 0x34, 0x12, 0x00, 0x04, 0x00, 0xc0, 0xf8 };
+
+  // the placeholder position of a decoder that has seen nothing is not published
+  publisher.publish(decoder);
+  publisher.read(snapshot);
+  IDRIVE_CHECK(snapshot.position == 0);
+
+  publisher.publish(decoder, events, decoder.decode(data, events));
+  publisher.read(snapshot);
+  IDRIVE_CHECK(snapshot.position == 0x1234);
+  IDRIVE_CHECK(snapshot.held == IDRIVEDECODER_EVENT(IDRIVEDECODER_MENU));
+  IDRIVE_CHECK(snapshot.counter == 0x50);
+
+  // across the wrap of the 16 bit position
+  const unsigned short positions[] = { 0xffff, 0x0002, 0x8000, 0x0000 };
+  const int32_t        expected[]  = { -1,     2,      0x8000, 0 };
+
+  for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+    data[0]++;
+    data[1] = positions[p];
+    data[2] = positions[p] >> 8;
+    publisher.publish(decoder, events, decoder.decode(data, events));
+    publisher.read(snapshot);
+    IDRIVE_CHECK(snapshot.position == expected[p]);
+  }
+
+  // an idle message publishes its counter only
+  data[0]++;
+  publisher.publish(decoder, events, decoder.decode(data, events));
+  publisher.read(snapshot);
+  IDRIVE_CHECK(snapshot.counter == data[0]);
+  IDRIVE_CHECK(snapshot.held == IDRIVEDECODER_EVENT(IDRIVEDECODER_MENU));
+
+  // released without a message, e.g. by IDriveInputTimer
+  decoder.release();
+  publisher.publish(decoder);
+  publisher.read(snapshot);
+  IDRIVE_CHECK(snapshot.held == 0);
+  IDRIVE_CHECK(snapshot.position == 0);
+}
+
+/* the writer turns the rotary by 1 and toggles menu with every message, a
+ * consistent snapshot has menu held exactly at odd positions */
+static void testConcurrent(void) {
+  IDriveStatePublisher publisher;
+  std::atomic<bool>    done(false);
+  unsigned long        reads[2] = { 0, 0 };
+  unsigned long        torn[2]  = { 0, 0 };
+
+  std::thread writer([&publisher, &done]() {
+    IDriveEncoder     encoder;
+    IDriveDecoderCore decoder;
+    unsigned char     data[8];
+
+    encoder.rotate(-0x7fff);
+    for (unsigned long i = 0; i < publishes; i++) {
+      if (i) {
+        encoder.rotate(1);
+        encoder.apply(i & 1 ? IDRIVEDECODER_MENU : IDRIVEDECODER_MENU_REL);
+      }
+      encoder.encode(data);
+
+      IDriveEvents events;
+      publisher.publish(decoder, events, decoder.decode(data, events));
+    }
+
+    done.store(true);
+  });
+
+  std::thread readers[2];
+  for (int r = 0; r < 2; r++) {
+    readers[r] = std::thread([&publisher, &done, &reads, &torn, r]() {
+      uint64_t last = 0;
+
+      while (!done.load()) {
+        IDriveSnapshot snapshot;
+        publisher.read(snapshot);
+
+        const bool menu = snapshot.held & IDRIVEDECODER_EVENT(IDRIVEDECODER_MENU);
+        if (snapshot.sequence < last || menu != (snapshot.position & 1) || !!snapshot.longHeld) {
+          torn[r]++;
+        }
+        last = snapshot.sequence;
+        reads[r]++;
+      }
+    });
+  }
+
+  writer.join();
+  readers[0].join();
+  readers[1].join();
+
+  IDRIVE_CHECK(torn[0] == 0 && torn[1] == 0);
+  IDRIVE_CHECK(reads[0] > 0 && reads[1] > 0);
+
+  IDriveSnapshot snapshot;
+  publisher.read(snapshot);
+  IDRIVE_CHECK(snapshot.sequence == publishes);
+  IDRIVE_CHECK(snapshot.position == (int32_t)publishes - 1);
+}
+
+int main() {
+  testPosition();
+  testConcurrent();
+
+  return idriveTestResult();
+}
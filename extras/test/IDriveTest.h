@@ -0,0 +1,100 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVETEST_H_
+#define IDRIVETEST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* minimal checks for the host tests, main returns idriveTestResult() */
+
+static unsigned long idriveTestFailures = 0;
+
+#define IDRIVE_CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      idriveTestFailures++; \
+    } \
+  } while (0)
+
+static inline int idriveTestResult(void) {
+  if (idriveTestFailures) {
+    fprintf(stderr, "%lu checks failed\n", idriveTestFailures);
+    return 1;
+  }
+  return 0;
+}
+
+/* xorshift32, the tests are reproducible without depending on rand() */
+class IDriveTestRandom {
+public:
+
+  explicit IDriveTestRandom(const uint32_t seed):state(seed ? seed : 1) {
+  }
+
+  inline uint32_t next(void) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // 0 .. n-1
+  inline uint32_t below(const uint32_t n) {
+    return next() % n;
+  }
+
+private:
+  uint32_t state;
+};
+
+/* n CAN-messages of random traffic: mostly consecutive counters with runs
+ * of idle repeats, some stale and reset messages and random input bytes */
+static inline void idriveRandomTraffic(uint8_t (*frames)[8], const size_t n, const uint32_t seed) {
+  IDriveTestRandom random(seed);
+  uint8_t frame[8] = { 0x00, 0xff, 0x7f, 0x00, 0x00, 0x00, 0xc0, 0xf8 };
+
+  for (size_t i = 0; i < n; i++) {
+    const uint32_t kind = random.below(64);
+
+    if (kind == 0) {
+      frame[0] = 0;                           // reset
+    } else if (kind == 1) {
+      frame[0] = random.next();               // stale or a gap
+    } else {
+      frame[0] = frame[0] == 0xff ? 1 : frame[0] + 1;
+    }
+
+    if (kind >= 32) {
+      for (unsigned char b = 1; b < 8; b++) {
+        if (!random.below(6)) {
+          frame[b] = random.next();
+        }
+      }
+    }
+
+    memcpy(frames[i], frame, sizeof(frame));
+  }
+}
+
+#endif /* IDRIVETEST_H_ */
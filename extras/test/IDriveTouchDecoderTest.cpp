@@ -0,0 +1,93 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* IDriveTouchDecoderCore on a short recorded-like sequence of touchpad
+ * messages */
+
+#include <IDriveTouchDecoder.h>
+
+#include "IDriveTest.h"
+
+static bool decode(IDriveTouchDecoderCore& decoder, const unsigned char counter, const unsigned char fingers, const unsigned short x, const unsigned short y, IDriveTouchEvent& event) {
+  const unsigned char data[8] = {
+    counter,
+    (unsigned char)x,
+    (unsigned char)((x >> 8 & 0x0f) | y << 4),
+    (unsigned char)(y >> 4),
+    fingers,
+    0x00, 0x00, 0x00
+  };
+  return decoder.decode(data, event);
+}
+
+static void checkEvent(const IDriveTouchEvent& event, const unsigned char type, const unsigned char fingers, const unsigned short x, const unsigned short y, const short dx, const short dy) {
+  IDRIVE_CHECK(event.type == type);
+  IDRIVE_CHECK(event.fingers == fingers);
+  IDRIVE_CHECK(event.x == x && event.y == y);
+  IDRIVE_CHECK(event.dx == dx && event.dy == dy);
+}
+
+static void testSequence(void) {
+  IDriveTouchDecoderCore decoder;
+  IDriveTouchEvent       event;
+
+  // no finger while nothing was touched is no event
+  IDRIVE_CHECK(!decode(decoder, 0x01, 0x11, 0, 0, event));
+
+  IDRIVE_CHECK(decode(decoder, 0x02, 0x10, 0x123, 0x456, event));
+  checkEvent(event, IDRIVETOUCH_PRESS, 1, 0x123, 0x456, 0, 0);
+
+  // the repeated message differs in the counter only
+  IDRIVE_CHECK(!decode(decoder, 0x03, 0x10, 0x123, 0x456, event));
+
+  IDRIVE_CHECK(decode(decoder, 0x04, 0x10, 0x120, 0x460, event));
+  checkEvent(event, IDRIVETOUCH_MOVE, 1, 0x120, 0x460, -3, 10);
+
+  IDRIVE_CHECK(decode(decoder, 0x05, 0x1f, 0x120, 0x460, event));
+  checkEvent(event, IDRIVETOUCH_MOVE, 3, 0x120, 0x460, 0, 0);
+
+  // the second finger alone does not move the touch
+  unsigned char data[8] = { 0x06, 0x20, 0x01, 0x46, 0x1f, 0x12, 0x34, 0x56 };
+  IDRIVE_CHECK(!decoder.decode(data, event));
+
+  IDRIVE_CHECK(decode(decoder, 0x07, 0x11, 0, 0, event));
+  checkEvent(event, IDRIVETOUCH_RELEASE, 0, 0x120, 0x460, 0, 0);
+}
+
+/* two fingers at 0/0 is a message with bytes 1-7 all zero, it is a real
+ * touch after construction and after reset */
+static void testZeroMessage(void) {
+  IDriveTouchDecoderCore decoder;
+  IDriveTouchEvent       event;
+
+  IDRIVE_CHECK(decode(decoder, 0x00, 0x00, 0, 0, event));
+  checkEvent(event, IDRIVETOUCH_PRESS, 2, 0, 0, 0, 0);
+  IDRIVE_CHECK(!decode(decoder, 0x01, 0x00, 0, 0, event));
+
+  decoder.reset();
+  IDRIVE_CHECK(decode(decoder, 0x02, 0x00, 0, 0, event));
+  checkEvent(event, IDRIVETOUCH_PRESS, 2, 0, 0, 0, 0);
+}
+
+int main() {
+  testSequence();
+  testZeroMessage();
+
+  return idriveTestResult();
+}
@@ -0,0 +1,134 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* converts logs to the binary capture format and plays captures back:
+ *
+ *   idrive-capture convert <log> <capture>
+ *   idrive-capture play [-t seconds] <capture>
+ *
+ * play starts at the given offset from the beginning of the capture, seeking
+ * through the block index instead of decoding everything before it.
+ */
+
+#include <IDriveDecoder.h>
+
+#include "IDriveCapture.h"
+#include "IDriveEventNames.h"
+#include "IDriveLogReplay.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int usage(const char *name) {
+  fprintf(stderr, "usage: %s convert <log> <capture>\n       %s play [-t seconds] <capture>\n", name, name);
+  return 2;
+}
+
+static int convert(const char *from, const char *to) {
+
+  IDriveLogReplay     log;
+  IDriveCaptureWriter capture;
+
+  if (!log.open(from)) {
+    fprintf(stderr, "%s: %s\n", from, strerror(errno));
+    return 1;
+  }
+
+  if (!capture.open(to)) {
+    fprintf(stderr, "%s: %s\n", to, strerror(errno));
+    return 1;
+  }
+
+  unsigned char data[8];
+  uint64_t      timestamp;
+
+  while (log.next(data, timestamp)) {
+    if (!capture.write(data, timestamp)) {
+      fprintf(stderr, "%s: %s\n", to, strerror(errno));
+      return 1;
+    }
+  }
+
+  if (!capture.close()) {
+    fprintf(stderr, "%s: %s\n", to, strerror(errno));
+    return 1;
+  }
+
+  printf("%zu messages\n", log.messages);
+  return 0;
+}
+
+static int play(const char *path, const double offset) {
+
+  IDriveCaptureReader capture;
+
+  if (!capture.open(path)) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  const unsigned char *data;
+  uint64_t             timestamp;
+  unsigned char        flags;
+
+  auto print = [&](const unsigned char eventId, const short rotary) {
+    printf("(%llu.%06llu) %s", (unsigned long long)(timestamp / 1000000000u), (unsigned long long)(timestamp % 1000000000u / 1000), idriveEventName(eventId));
+    if (eventId == IDRIVEDECODER_ROTARY) {
+      printf(" %d", rotary);
+    }
+    printf("\n");
+  };
+
+  auto decoder = makeIDriveDecoder(
+    [&](unsigned char eventId) { print(eventId, 0); },
+    [&](short rotary) { print(IDRIVEDECODER_ROTARY, rotary); });
+
+  if (capture.blocks().empty()) {
+    return 0;
+  }
+
+  if (offset > 0 && !capture.seek(capture.blocks()[0].block.time + (uint64_t)(offset * 1e9), decoder)) {
+    return 0;
+  }
+
+  while (capture.next(data, timestamp, flags)) {
+    decoder.decode(data);
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+
+  if (argc == 4 && !strcmp(argv[1], "convert")) {
+    return convert(argv[2], argv[3]);
+  }
+
+  if (argc == 3 && !strcmp(argv[1], "play")) {
+    return play(argv[2], 0);
+  }
+
+  if (argc == 5 && !strcmp(argv[1], "play") && !strcmp(argv[2], "-t")) {
+    return play(argv[4], atof(argv[3]));
+  }
+
+  return usage(argv[0]);
+}
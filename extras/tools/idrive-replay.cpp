@@ -0,0 +1,142 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* replays a candump (-l) or Vector ASC log through the decoder:
+ *
+ *   idrive-replay [-s] [-j threads] <log>
+ *
+ * prints every event with the timestamp of its message, or with -s only
+ * counts per event and the throughput. -j reads the whole log first and
+ * decodes it with IDriveParallelDecoder, the output stays the same.
+ */
+
+#include <IDriveDecoder.h>
+
+#include "IDriveEventNames.h"
+#include "IDriveLogReplay.h"
+#include "IDriveParallelDecoder.h"
+
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+int main(int argc, char **argv) {
+
+  bool     statistics = false;
+  unsigned threads    = 0;
+  int      option;
+
+  while ((option = getopt(argc, argv, "sj:")) != -1) {
+    switch (option) {
+    case 's':
+      statistics = true;
+      break;
+    case 'j':
+      threads = atoi(optarg);
+      if (!threads) {
+        threads = 1;
+      }
+      break;
+    default:
+      optind = argc + 1;
+      break;
+    }
+  }
+
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: %s [-s] [-j threads] <log>\n", argv[0]);
+    return 2;
+  }
+
+  const char *path = argv[optind];
+  IDriveLogReplay log;
+
+  if (!log.open(path)) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  unsigned long counts[IDRIVEDECODER_OPTION_REL + 1] = { 0 };
+  unsigned char data[8];
+  uint64_t      timestamp;
+
+  auto print = [&](const unsigned char eventId, const short rotary) {
+    counts[eventId]++;
+    if (statistics) {
+      return;
+    }
+    printf("(%llu.%06llu) %s", (unsigned long long)(timestamp / 1000000000u), (unsigned long long)(timestamp % 1000000000u / 1000), idriveEventName(eventId));
+    if (eventId == IDRIVEDECODER_ROTARY) {
+      printf(" %d", rotary);
+    }
+    printf("\n");
+  };
+
+  auto decoder = makeIDriveDecoder<IDriveDecoderStats>(
+    [&](unsigned char eventId) { print(eventId, 0); },
+    [&](short rotary) { print(IDRIVEDECODER_ROTARY, rotary); });
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  if (threads) {
+    std::vector<uint8_t>  frames;
+    std::vector<uint64_t> timestamps;
+
+    while (log.next(data, timestamp)) {
+      frames.insert(frames.end(), data, data + sizeof(data));
+      timestamps.push_back(timestamp);
+    }
+
+    std::vector<IDriveEventRecord> records;
+    IDriveParallelDecoder          parallel(threads);
+
+    parallel.decode(reinterpret_cast<const uint8_t (*)[8]>(frames.data()), timestamps.size(), records);
+
+    for (size_t r = 0; r < records.size(); r++) {
+      timestamp = timestamps[records[r].frame];
+      print(records[r].eventId, records[r].value);
+    }
+  } else {
+    while (log.next(data, timestamp)) {
+      decoder.decode(data);
+    }
+  }
+
+  if (statistics) {
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%zu lines, %zu messages, %.3f s, %.1f MB/s\n", log.lines, log.messages, elapsed, log.size() / elapsed / 1e6);
+    if (!threads) {
+      const IDriveDecoderStats &stats = decoder.stats();
+      printf("%lu stale, %lu resets, %lu idle, %lu gaps, %lu lost\n", (unsigned long)stats.stale, (unsigned long)stats.resets,
+        (unsigned long)stats.idle, (unsigned long)stats.gaps, (unsigned long)stats.lost);
+    }
+    for (unsigned char eventId = 0; eventId <= IDRIVEDECODER_OPTION_REL; eventId++) {
+      if (counts[eventId]) {
+        printf("%-16s %lu\n", idriveEventName(eventId), counts[eventId]);
+      }
+    }
+  }
+
+  return 0;
+}
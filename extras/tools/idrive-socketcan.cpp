@@ -0,0 +1,117 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* prints the events of an iDrive controller on a SocketCAN interface:
+ *
+ *   idrive-socketcan can0
+ *
+ * To try it without hardware:
+ *
+ *   ip link add dev vcan0 type vcan && ip link set up vcan0
+ *   idrive-socketcan vcan0 &
+ *   cansend vcan0 25B#01FF7F000400C0F8   # MENU
+ *
+ * kill -USR1 prints log2 histograms (bucket:count, ns) and p99/p99.9 of the
+ * decode and callback latencies to stderr.
+ */
+
+#include <IDriveDecoder.h>
+#include <IDriveLatencyTrace.h>
+
+#include "IDriveEventNames.h"
+#include "IDriveSocketCan.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef IDriveLatencyTrace<IDriveMonotonicClock> Trace;
+
+static uint64_t stamp;
+static volatile sig_atomic_t dump;
+
+static void requestDump(int) {
+  dump = 1;
+}
+
+static void print(const char *name, const IDriveHistogram& histogram) {
+  char buckets[512];
+  histogram.format(buckets, sizeof(buckets));
+  fprintf(stderr, "%-8s p99 %lu p99.9 %lu  %s\n", name, (unsigned long)histogram.percentile(990), (unsigned long)histogram.percentile(999), buckets);
+}
+
+static void print(const unsigned char eventId, const short rotary) {
+  printf("(%llu.%06llu) %s", (unsigned long long)(stamp / 1000000000u), (unsigned long long)(stamp % 1000000000u / 1000), idriveEventName(eventId));
+  if (eventId == IDRIVEDECODER_ROTARY) {
+    printf(" %d", rotary);
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv) {
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <interface>\n", argv[0]);
+    return 2;
+  }
+
+  static IDriveSocketCan can;
+
+  if (!can.open(argv[1])) {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+
+  // no SA_RESTART, receive returns with EINTR
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = requestDump;
+  sigaction(SIGUSR1, &action, 0);
+
+  auto decoder = makeIDriveDecoder<IDriveNoStats, Trace>(
+    [](unsigned char eventId) { print(eventId, 0); },
+    [](short rotary) { print(IDRIVEDECODER_ROTARY, rotary); });
+
+  for (;;) {
+    const int n = can.receive();
+
+    if (dump) {
+      dump = 0;
+      print("decode",  decoder.trace().decode);
+      print("handler", decoder.trace().handler);
+      print("total",   decoder.trace().total);
+    }
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+      return 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+      stamp = can.timestamp(i);
+      decoder.decode(can.data(i));
+    }
+
+    fflush(stdout);
+  }
+}
@@ -0,0 +1,87 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* prints the events of a binary event stream (IDriveEventStream.h), e.g.
+ * from the IDriveEventStream example:
+ *
+ *   stty -F /dev/ttyACM0 115200 raw && idrive-stream /dev/ttyACM0
+ *
+ * reads stdin without an argument. Times are the ticks of the sender's
+ * clock since its last sync, ms with millis().
+ */
+
+#include <IDriveEventStream.h>
+
+#include "IDriveEventNames.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(int argc, char **argv) {
+
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [device]\n", argv[0]);
+    return 2;
+  }
+
+  const int fd = argc == 2 ? open(argv[1], O_RDONLY | O_NOCTTY) : 0;
+
+  if (fd < 0) {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+
+  IDriveStreamDecoder stream;
+  unsigned char       buffer[256];
+
+  for (;;) {
+    const ssize_t n = read(fd, buffer, sizeof(buffer));
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (n <= 0) {
+      break;
+    }
+
+    for (ssize_t i = 0; i < n; i++) {
+      if (!stream.push(buffer[i])) {
+        continue;
+      }
+
+      printf("%10lu %s", (unsigned long)stream.time, idriveEventName(stream.eventId));
+      if (stream.eventId == IDRIVEDECODER_ROTARY) {
+        printf(" %d", stream.value);
+      }
+      printf("\n");
+    }
+
+    fflush(stdout);
+  }
+
+  if (stream.errors) {
+    fprintf(stderr, "%lu errors\n", stream.errors);
+  }
+
+  return 0;
+}
@@ -18,273 +18,291 @@
  */
 
 #include "IDriveDecoder.h"
+#include "IDriveDecoderSimd.h"
+#include "IDrivePgmSpace.h"
 
-IDriveDecoder::IDriveDecoder(const void (&switchEvent)(const unsigned char&),const void (&rotaryEvent)(const short&)):switchEvent(switchEvent),rotaryEvent(rotaryEvent) {
-}
+constexpr IDriveDecoderCore::Input IDriveDecoderCore::inputs[IDriveDecoderCore::inputCount];
 
-void IDriveDecoder::decode(const unsigned char* data) {
+/* state of the five inputs of the knob for each value of data[3]:
+ * center depends on the two low bits only (press wins over long-press),
+ * the direction on the high nibble only. knobDirection holds the bits of
+ * lastSwitch[0] in the high byte and those of lastSwitch[1] in the low byte.
+ */
+const unsigned char IDriveDecoderCore::knobCenter[4] PROGMEM = {
+  0x00, 0x80, 0x40, 0x80
+};
 
-  const unsigned char &counter = data[0];
+const unsigned short IDriveDecoderCore::knobDirection[16] PROGMEM = {
+  0x0000, // 0x00
+  0x0800, // 0x10 up
+  0x0400, // 0x20 up long
+  0x0000, // 0x30
+  0x0200, // 0x40 right
+  0x0100, // 0x50 right long
+  0x0000, // 0x60
+  0x0080, // 0x70 down
+  0x0040, // 0x80 down long
+  0x0000, // 0x90
+  0x2000, // 0xa0 left
+  0x1000, // 0xb0 left long
+  0x0000, // 0xc0
+  0x0000, // 0xd0
+  0x0000, // 0xe0
+  0x0000  // 0xf0
+};
 
-  if (counter == 0) {
-    reset();
+namespace {
+
+/* appends the events of one CAN-message to an IDriveEventSink */
+class IDriveEventRecorder {
+public:
+
+  IDriveEventSink& sink;
+  uint32_t         frame;
+
+  IDriveEventRecorder(IDriveEventSink& sink):sink(sink),frame(0) {
   }
 
-  const unsigned char diff = counter - lastCounter;
+  inline void operator()(const unsigned char eventId) {
+    record(eventId, 0);
+  }
 
-  if (diff > 0x7f) {
-    return;
+  inline void operator()(const short rotary) {
+    record(IDRIVEDECODER_ROTARY, rotary);
   }
 
-  lastCounter = counter;
+private:
 
-  const unsigned short pos = data[2] << 8 | data[1];
+  inline void record(const unsigned char eventId, const short value) {
+    IDriveEventRecord &record = sink.records[sink.count++];
+    record.frame   = frame;
+    record.value   = value;
+    record.eventId = eventId;
+  }
+};
 
-  if (pos != lastPos) {
-    rotaryEvent(pos-lastPos);
-    lastPos = pos;
+}
+
+IDriveDecoderCore::IDriveDecoderCore() {
+  reset();
+}
+
+void IDriveDecoderCore::saveState(IDriveDecoderState& state) const {
+  state.version     = IDRIVEDECODER_STATE_VERSION;
+  state.counter     = registers.counter;
+  state.switches[0] = registers.switches[0];
+  state.switches[1] = registers.switches[1];
+  state.switches[2] = registers.switches[2];
+  state.reserved    = 0;
+  state.pos         = registers.pos;
+}
+
+bool IDriveDecoderCore::restoreState(const IDriveDecoderState& state) {
+
+  if (state.version != IDRIVEDECODER_STATE_VERSION) {
+    return false;
   }
 
-  const unsigned char &data3 = data[3];
+  reset();
 
-  if (isCenter3(data3)) {
-    if (!wasCenter()) {
-      setLastCenter();
-      switchEvent(IDRIVEDECODER_CENTER);
-    }
-  } else {
-    if (isCenterExt3(data3)) {
-      if (!wasCenterExt()) {
-        setLastCenterExt();
-        switchEvent(IDRIVEDECODER_CENTER_EXT);
-      }
-    } else {
-      if (wasCenterOrExt()) {
-        clearLastCenter();
-        switchEvent(IDRIVEDECODER_CENTER_REL);
-      }
+  registers.counter     = state.counter;
+  registers.switches[0] = state.switches[0];
+  registers.switches[1] = state.switches[1];
+  registers.switches[2] = state.switches[2];
+  registers.pos         = state.pos;
+
+  // frame has to be a message that decodes to exactly this state
+  unsigned char *frame = reinterpret_cast<unsigned char*>(&registers.frame);
+  frame[1] = registers.pos;
+  frame[2] = registers.pos >> 8;
+
+  for (unsigned char i = 0; i < inputCount; i++) {
+    Input input;
+    memcpy_P(&input, &inputs[i], sizeof(input));
+
+    const unsigned char current = registers.switches[input.slot] & (input.stateBit | input.stateBit >> 1);
+    unsigned char &value = frame[input.index];
+
+    if (current == input.stateBit) {
+      value = (value & ~input.pressMask) | input.pressBits;
+    } else if (current) {
+      value = (value & ~input.extMask) | input.extBits;
     }
   }
 
-  if (isLeft3(data3)) {
-    if (!wasLeft()) {
-      setLastLeft();
-      switchEvent(IDRIVEDECODER_LEFT);
-    }
-  } else {
-    if (isLeftExt3(data3)) {
-      if (!wasLeftExt()) {
-        setLastLeftExt();
-        switchEvent(IDRIVEDECODER_LEFT_EXT);
-      }
-    } else {
-      if (wasLeftOrExt()) {
-        clearLastLeft();
-        switchEvent(IDRIVEDECODER_LEFT_REL);
-      }
+  return true;
+}
+
+void IDriveDecoderCore::release(void) {
+  registers.switches[0] = 0;
+  registers.switches[1] = 0;
+  registers.switches[2] = 0;
+
+  // the input bytes of the 'Release' message, see reset
+  unsigned char *frame = reinterpret_cast<unsigned char*>(&registers.frame);
+  frame[3] = 0x00;
+  frame[4] = 0x00;
+  frame[5] = 0x00;
+  frame[6] = 0xc0;
+  frame[7] = 0xf8;
+}
+
+uint64_t IDriveDecoderCore::held(const unsigned char (&switches)[3]) {
+  uint64_t mask = 0;
+
+  for (unsigned char i = 0; i < inputCount; i++) {
+    const unsigned char slot     = pgm_read_byte(&inputs[i].slot);
+    const unsigned char stateBit = pgm_read_byte(&inputs[i].stateBit);
+
+    if (switches[slot] & (stateBit | stateBit >> 1)) {
+      mask |= IDRIVEDECODER_EVENT(pgm_read_byte(&inputs[i].eventId));
     }
   }
 
-  if (isUp3(data3)) {
-    if (!wasUp()) {
-      setLastUp();
-      switchEvent(IDRIVEDECODER_UP);
-    }
-  } else {
-    if (isUpExt3(data3)) {
-      if (!wasUpExt()) {
-        setLastUpExt();
-        switchEvent(IDRIVEDECODER_UP_EXT);
-      }
-    } else {
-      if (wasUpOrExt()) {
-        clearLastUp();
-        switchEvent(IDRIVEDECODER_UP_REL);
-      }
+  return mask;
+}
+
+uint64_t IDriveDecoderCore::longHeld(const unsigned char (&switches)[3]) {
+  uint64_t mask = 0;
+
+  for (unsigned char i = 0; i < inputCount; i++) {
+    const unsigned char slot     = pgm_read_byte(&inputs[i].slot);
+    const unsigned char stateBit = pgm_read_byte(&inputs[i].stateBit);
+
+    if ((switches[slot] & (stateBit | stateBit >> 1)) == stateBit >> 1) {
+      mask |= IDRIVEDECODER_EVENT(pgm_read_byte(&inputs[i].eventId));
     }
   }
 
-  if (isRight3(data3)) {
-    if (!wasRight()) {
-      setLastRight();
-      switchEvent(IDRIVEDECODER_RIGHT);
-    }
-  } else {
-    if (isRightExt3(data3)) {
-      if (!wasRightExt()) {
-        setLastRightExt();
-        switchEvent(IDRIVEDECODER_RIGHT_EXT);
-      }
-    } else {
-      if (wasRightOrExt()) {
-        clearLastRight();
-        switchEvent(IDRIVEDECODER_RIGHT_REL);
-      }
-    }
+  return mask;
+}
+
+unsigned char IDriveDecoderCore::decode(const unsigned char* data, IDriveEvents& events) {
+  return decode(data, registers, events);
+}
+
+unsigned char IDriveDecoderCore::accept(const unsigned char* data, Registers& registers, IDriveEvents& events, uint64_t& changed) {
+
+  unsigned char  &lastCounter = registers.counter;
+  unsigned short &lastPos     = registers.pos;
+  uint64_t       &lastFrame   = registers.frame;
+
+  events.mask   = 0;
+  events.rotary = 0;
+
+  const unsigned char &counter = data[0];
+  unsigned char status = 0;
+
+  if (counter == 0) {
+    reset(registers);
+    status = IDRIVEDECODER_RESET;
   }
 
-  if (isDown3(data3)) {
-    if (!wasDown()) {
-      setLastDown();
-      switchEvent(IDRIVEDECODER_DOWN);
-    }
-  } else {
-    if (isDownExt3(data3)) {
-      if (!wasDownExt()) {
-        setLastDownExt();
-        switchEvent(IDRIVEDECODER_DOWN_EXT);
-      }
-    } else {
-      if (wasDownOrExt()) {
-        clearLastDown();
-        switchEvent(IDRIVEDECODER_DOWN_REL);
-      }
-    }
+  const unsigned char diff = counter - lastCounter;
+
+  if (diff > 0x7f) {
+    return IDRIVEDECODER_STALE;
   }
 
-  const unsigned char &data4 = data[4];
+  lastCounter = counter;
 
-  if (isMenu4(data4)) {
-    if (!wasMenu()) {
-      setLastMenu();
-      switchEvent(IDRIVEDECODER_MENU);
-    }
-  } else {
-    if (isMenuExt4(data4)) {
-      if (!wasMenuExt()) {
-        setLastMenuExt();
-        switchEvent(IDRIVEDECODER_MENU_EXT);
-      }
-    } else {
-      if (wasMenuOrExt()) {
-        clearLastMenu();
-        switchEvent(IDRIVEDECODER_MENU_REL);
-      }
-    }
+  // idle controllers repeat the same message, compare it all at once
+  uint64_t frame;
+  memcpy(&frame, data, sizeof(frame));
+  reinterpret_cast<unsigned char*>(&frame)[0] = 0;
+
+  if (reinterpret_cast<const unsigned char*>(&lastFrame)[0]) {
+    status |= IDRIVEDECODER_FIRST;
   }
 
-  if (isBack4(data4)) {
-    if (!wasBack()) {
-      setLastBack();
-      switchEvent(IDRIVEDECODER_BACK);
-    }
-  } else {
-    if (isBackExt4(data4)) {
-      if (!wasBackExt()) {
-        setLastBackExt();
-        switchEvent(IDRIVEDECODER_BACK_EXT);
-      }
-    } else {
-      if (wasBackOrExt()) {
-        clearLastBack();
-        switchEvent(IDRIVEDECODER_BACK_REL);
-      }
-    }
+  changed = frame ^ lastFrame;
+
+  if (!changed) {
+    return status | IDRIVEDECODER_IDLE;
   }
 
-  const unsigned char &data5 = data[5];
+  lastFrame = frame;
 
-  if (isCom5(data5)) {
-    if (!wasCom()) {
-      setLastCom();
-      switchEvent(IDRIVEDECODER_COM);
-    }
-  } else {
-    if (isComExt5(data5)) {
-      if (!wasComExt()) {
-        setLastComExt();
-        switchEvent(IDRIVEDECODER_COM_EXT);
-      }
-    } else {
-      if (wasComOrExt()) {
-        clearLastCom();
-        switchEvent(IDRIVEDECODER_COM_REL);
-      }
-    }
+  const unsigned char *delta = reinterpret_cast<const unsigned char*>(&changed);
+
+  if (delta[1] | delta[2]) {
+    const unsigned short pos = data[2] << 8 | data[1];
+    events.rotary = pos-lastPos;
+    lastPos = pos;
   }
 
-  if (isOption5(data5)) {
-    if (!wasOption()) {
-      setLastOption();
-      switchEvent(IDRIVEDECODER_OPTION);
-    }
-  } else {
-    if (isOptionExt5(data5)) {
-      if (!wasOptionExt()) {
-        setLastOptionExt();
-        switchEvent(IDRIVEDECODER_OPTION_EXT);
-      }
-    } else {
-      if (wasOptionOrExt()) {
-        clearLastOption();
-        switchEvent(IDRIVEDECODER_OPTION_REL);
-      }
-    }
+  return status;
+}
+
+unsigned char IDriveDecoderCore::decode(const unsigned char* data, Registers& registers, IDriveEvents& events) {
+
+  uint64_t changed;
+  const unsigned char status = accept(data, registers, events, changed);
+
+  if (status & (IDRIVEDECODER_STALE | IDRIVEDECODER_IDLE)) {
+    return status;
   }
 
-  const unsigned char &data6 = data[6];
+  const unsigned char *delta = reinterpret_cast<const unsigned char*>(&changed);
 
-  if (isMedia6(data6)) {
-    if (!wasMedia()) {
-      setLastMedia();
-      switchEvent(IDRIVEDECODER_MEDIA);
-    }
-  } else {
-    if (isMediaExt6(data6)) {
-      if (!wasMediaExt()) {
-        setLastMediaExt();
-        switchEvent(IDRIVEDECODER_MEDIA_EXT);
-      }
-    } else {
-      if (wasMediaOrExt()) {
-        clearLastMedia();
-        switchEvent(IDRIVEDECODER_MEDIA_REL);
-      }
-    }
+  if (!inputsChanged(delta)) {
+    return status;
   }
 
-  if (isNav6(data6)) {
-    if (!wasNav()) {
-      setLastNav();
-      switchEvent(IDRIVEDECODER_NAV);
-    }
-  } else {
-    if (isNavExt6(data6)) {
-      if (!wasNavExt()) {
-        setLastNavExt();
-        switchEvent(IDRIVEDECODER_NAV_EXT);
-      }
-    } else {
-      if (wasNavOrExt()) {
-        clearLastNav();
-        switchEvent(IDRIVEDECODER_NAV_REL);
-      }
-    }
+  unsigned char (&lastSwitch)[3] = registers.switches;
+
+  unsigned char state[3] = { lastSwitch[0], lastSwitch[1], lastSwitch[2] };
+
+  if (delta[3]) {
+    const unsigned char &data3 = data[3];
+    const unsigned short direction = pgm_read_word(&knobDirection[data3 >> 4]);
+
+    state[0] = pgm_read_byte(&knobCenter[data3 & 0x03]) | direction >> 8;
+    state[1] = (state[1] & 0x3f) | (direction & 0xc0);
   }
 
-  const unsigned char &data7 = data[7];
+  Row<IDRIVEDECODER_INPUT_ALL, knobInputs>::decode(data, delta, state);
+  Row<IDRIVEDECODER_INPUT_ALL, 0>::emit(state, lastSwitch, events.mask);
+
+  return status;
+}
 
-  if (isMap7(data7)) {
-    if (!wasMap()) {
-      setLastMap();
-      switchEvent(IDRIVEDECODER_MAP);
+void IDriveDecoderCore::record(const IDriveEvents& events, const uint32_t frame, IDriveEventSink& sink) {
+  IDriveEventRecorder recorder(sink);
+  recorder.frame = frame;
+  dispatch(events, recorder, recorder);
+}
+
+size_t IDriveDecoderCore::decodeBatch(const uint8_t (*frames)[8], size_t n, IDriveEventSink& sink) {
+
+  size_t i = 0;
+
+  while (i < n) {
+    if (sink.capacity - sink.count < IDRIVEDECODER_MAX_EVENTS) {
+      return i;
     }
-  } else {
-    if (isMapExt7(data7)) {
-      if (!wasMapExt()) {
-        setLastMapExt();
-        switchEvent(IDRIVEDECODER_MAP_EXT);
-      }
-    } else {
-      if (wasMapOrExt()) {
-        clearLastMap();
-        switchEvent(IDRIVEDECODER_MAP_REL);
+
+    // once the previous message was accepted, idle repeats only advance lastCounter
+    if (i > 0 && registers.counter == frames[i - 1][0]) {
+      const size_t idle = IDriveDecoderSimd::idleRun(frames + i, n - i);
+
+      if (idle) {
+        i += idle;
+        registers.counter = frames[i - 1][0];
+        continue;
       }
     }
-  }
-}
 
+    IDriveEvents events;
+
+    decode(frames[i], events);
+
+    if (events.rotary || events.mask) {
+      record(events, i, sink);
+    }
+
+    i++;
+  }
 
-IDriveDecoder::~IDriveDecoder() {
-  // TODO Auto-generated destructor stub
+  return n;
 }
@@ -20,6 +20,12 @@
 #ifndef IDRIVEDECODER_H_
 #define IDRIVEDECODER_H_
 
+#include "IDrivePgmSpace.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
 /* CAN-message format:
  *
  * 0   Counter (1 byte)
@@ -108,21 +114,241 @@
 #define IDRIVEDECODER_OPTION_EXT 35
 #define IDRIVEDECODER_OPTION_REL 36
 
-class IDriveDecoder {
+#define IDRIVEDECODER_EVENT(eventId) ((uint64_t)1 << (eventId))
+#define IDRIVEDECODER_PRESS_EVENTS 0x0000000492492492ULL  // IDRIVEDECODER_EVENT of every press-eventId
+
+/* inputs a decoder handles, in the order of IDriveDecoderCore::inputs */
+#define IDRIVEDECODER_INPUT_CENTER 0x0001
+#define IDRIVEDECODER_INPUT_LEFT   0x0002
+#define IDRIVEDECODER_INPUT_UP     0x0004
+#define IDRIVEDECODER_INPUT_RIGHT  0x0008
+#define IDRIVEDECODER_INPUT_DOWN   0x0010
+#define IDRIVEDECODER_INPUT_MENU   0x0020
+#define IDRIVEDECODER_INPUT_BACK   0x0040
+#define IDRIVEDECODER_INPUT_COM    0x0080
+#define IDRIVEDECODER_INPUT_OPTION 0x0100
+#define IDRIVEDECODER_INPUT_MEDIA  0x0200
+#define IDRIVEDECODER_INPUT_NAV    0x0400
+#define IDRIVEDECODER_INPUT_MAP    0x0800
+#define IDRIVEDECODER_INPUT_KNOB   0x001f  // center and the four directions
+#define IDRIVEDECODER_INPUT_ALL    0x0fff
+
+#define IDRIVEDECODER_ROTARY      0   // eventId of rotary records in an IDriveEventSink
+#define IDRIVEDECODER_MAX_EVENTS 13   // rotary plus one event per input
+
+/* what decode did with a CAN-message, 0 if it was accepted and changed */
+#define IDRIVEDECODER_STALE 0x01  // counter behind the last one, ignored
+#define IDRIVEDECODER_RESET 0x02  // counter 0, the decoder was reset first
+#define IDRIVEDECODER_IDLE  0x04  // accepted, same as the previous message
+#define IDRIVEDECODER_FIRST 0x08  // accepted first after construction, a reset or restoreState
+
+/* result of decoding a single CAN-message without callbacks */
+struct IDriveEvents {
+  uint64_t mask;    // IDRIVEDECODER_EVENT(eventId) for every event that fired
+  short    rotary;  // change of the rotary position, 0 if it did not move
+};
+
+/* one event decoded by decodeBatch */
+struct IDriveEventRecord {
+  uint32_t      frame;    // index of the CAN-message within the batch
+  short         value;    // change of the rotary position for IDRIVEDECODER_ROTARY
+  unsigned char eventId;  // IDRIVEDECODER_ROTARY or one of IDRIVEDECODER_*
+};
+
+/* preallocated buffer decodeBatch appends its records to */
+struct IDriveEventSink {
+  IDriveEventRecord* records;
+  size_t             capacity;
+  size_t             count;
+};
+
+#define IDRIVEDECODER_STATE_VERSION 1
+
+/* everything the decoder remembers between CAN-messages. Plain bytes that can
+ * be copied, stored or sent as they are; version changes with the layout or
+ * meaning of the fields.
+ */
+struct IDriveDecoderState {
+  unsigned char  version;      // IDRIVEDECODER_STATE_VERSION
+  unsigned char  counter;      // lastCounter
+  unsigned char  switches[3];  // lastSwitch
+  unsigned char  reserved;     // 0
+  unsigned short pos;          // lastPos
+};
+
+static_assert(sizeof(IDriveDecoderState) <= 8, "IDriveDecoderState has to fit into 8 bytes");
+
+/* decoder state and the callback-free decode */
+class IDriveDecoderCore {
 public:
 
-  const void (&switchEvent)(const unsigned char&);
-  const void (&rotaryEvent)(const short&);
-  IDriveDecoder(const void (&switchEvent)(const unsigned char&), const void (&rotaryEvent)(const short&));
-  void decode(const unsigned char* data);
-  virtual ~IDriveDecoder();
+  IDriveDecoderCore();
+  /* returns 0 or IDRIVEDECODER_STALE, _RESET, _IDLE, _FIRST */
+  unsigned char decode(const unsigned char* data, IDriveEvents& events);
+
+  /* decodes n consecutive CAN-messages, returns the number of messages
+   * consumed. Stops early when less than IDRIVEDECODER_MAX_EVENTS records
+   * are left in the sink, continue with frames + consumed once drained.
+   */
+  size_t decodeBatch(const uint8_t (*frames)[8], size_t n, IDriveEventSink& sink);
+
+  /* the state decode works on. Decoders that keep it in a layout of their own
+   * (IDriveDecoderBank) load it into Registers and use the static functions.
+   */
+  struct Registers {
+    uint64_t       frame;        // bytes 1-7 of the last accepted CAN-message, byte 0 is 1 until one was accepted after reset
+    unsigned short pos;          // always bytes 1,2 of frame
+    unsigned char  counter;
+    unsigned char  switches[3];  // bits per input, see IDriveDecoderCore::inputs
+  };
+
+  static inline void reset(Registers& registers) {
+    registers.counter     = 0xff;
+    registers.pos         = 0x7fff;
+    registers.switches[0] = 0;
+    registers.switches[1] = 0;
+    registers.switches[2] = 0;
+
+    // the 'Release' message matching the state above, not accepted yet
+    unsigned char *frame = reinterpret_cast<unsigned char*>(&registers.frame);
+    frame[0] = 0x01;
+    frame[1] = 0xff;
+    frame[2] = 0x7f;
+    frame[3] = 0x00;
+    frame[4] = 0x00;
+    frame[5] = 0x00;
+    frame[6] = 0xc0;
+    frame[7] = 0xf8;
+  }
+
+  static unsigned char decode(const unsigned char* data, Registers& registers, IDriveEvents& events);
+
+  /* decode for the IDRIVEDECODER_INPUT_* in Inputs only. The other inputs
+   * never fire and their state bits stay 0. The inputs are decoded by code
+   * unrolled at compile time, so the unused ones take neither flash nor
+   * cycles. IDRIVEDECODER_INPUT_ALL is decode.
+   */
+  template<uint16_t Inputs>
+  static inline unsigned char decodeInputs(const unsigned char* data, Registers& registers, IDriveEvents& events) {
+
+    if (Inputs == IDRIVEDECODER_INPUT_ALL) {
+      return decode(data, registers, events);
+    }
+
+    uint64_t changed;
+    const unsigned char status = accept(data, registers, events, changed);
+
+    if (status & (IDRIVEDECODER_STALE | IDRIVEDECODER_IDLE)) {
+      return status;
+    }
+
+    const unsigned char *delta = reinterpret_cast<const unsigned char*>(&changed);
+
+    if (!inputsChanged(delta)) {
+      return status;
+    }
+
+    unsigned char state[3] = { registers.switches[0], registers.switches[1], registers.switches[2] };
+
+    if ((Inputs & IDRIVEDECODER_INPUT_KNOB) && delta[3]) {
+      const unsigned char knob0 = stateMask(Inputs & IDRIVEDECODER_INPUT_KNOB, 0);
+      const unsigned char knob1 = stateMask(Inputs & IDRIVEDECODER_INPUT_KNOB, 1);
+      const unsigned short direction = pgm_read_word(&knobDirection[data[3] >> 4]);
+
+      state[0] = (pgm_read_byte(&knobCenter[data[3] & 0x03]) | direction >> 8) & knob0;
+      if (knob1) {
+        state[1] = (state[1] & ~knob1) | (direction & knob1);
+      }
+    }
+
+    Row<Inputs, knobInputs>::decode(data, delta, state);
+    Row<Inputs, 0>::emit(state, registers.switches, events.mask);
+
+    return status;
+  }
+
+  /* appends events to sink as decodeBatch does, sink needs room for
+   * IDRIVEDECODER_MAX_EVENTS records */
+  static void record(const IDriveEvents& events, const uint32_t frame, IDriveEventSink& sink);
+
+  /* checkpoint the decoder, e.g. to continue decoding mid-stream later on.
+   * restoreState returns false and leaves the decoder untouched if the state
+   * was saved with another IDRIVEDECODER_STATE_VERSION.
+   */
+  void saveState(IDriveDecoderState& state) const;
+  bool restoreState(const IDriveDecoderState& state);
+
+  /* IDRIVEDECODER_EVENT(press-eventId) of every input that is pressed or long
+   * pressed in the state bits switches, e.g. IDriveDecoderState::switches */
+  static uint64_t held(const unsigned char (&switches)[3]);
+
+  // the same for the inputs long pressed only
+  static uint64_t longHeld(const unsigned char (&switches)[3]);
+
+  /* forgets the pressed inputs without reporting their release, e.g. once
+   * IDriveInputTimer released them. Counter and rotary are kept, inputs still
+   * held are reported pressed again by the next CAN-message. */
+  void release(void);
+
+  // of the last accepted CAN-message
+  inline unsigned char counter(void) const {
+    return registers.counter;
+  }
+
+  /* false until a CAN-message was accepted after construction, a reset or
+   * restoreState, the position is a placeholder until then */
+  inline bool accepted(void) const {
+    return !reinterpret_cast<const unsigned char*>(&registers.frame)[0];
+  }
+
+protected:
+
+  template<uint16_t Inputs>
+  inline unsigned char decodeInputs(const unsigned char* data, IDriveEvents& events) {
+    return decodeInputs<Inputs>(data, registers, events);
+  }
+
+  /* report events in the order they are decoded: rotary first, then the
+   * inputs in the order of IDriveDecoderCore::inputs. Inputs not in Inputs
+   * are not looked at.
+   */
+  template<uint16_t Inputs = IDRIVEDECODER_INPUT_ALL, class SwitchHandler, class RotaryHandler>
+  static inline void dispatch(const IDriveEvents& events, SwitchHandler& switchEvent, RotaryHandler& rotaryEvent) {
+    if (events.rotary) {
+      rotaryEvent(events.rotary);
+    }
+
+    if (!events.mask) {
+      return;
+    }
+
+    if (Inputs & IDRIVEDECODER_INPUT_CENTER) dispatch(events.mask, IDRIVEDECODER_CENTER, switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_LEFT)   dispatch(events.mask, IDRIVEDECODER_LEFT,   switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_UP)     dispatch(events.mask, IDRIVEDECODER_UP,     switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_RIGHT)  dispatch(events.mask, IDRIVEDECODER_RIGHT,  switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_DOWN)   dispatch(events.mask, IDRIVEDECODER_DOWN,   switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_MENU)   dispatch(events.mask, IDRIVEDECODER_MENU,   switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_BACK)   dispatch(events.mask, IDRIVEDECODER_BACK,   switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_COM)    dispatch(events.mask, IDRIVEDECODER_COM,    switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_OPTION) dispatch(events.mask, IDRIVEDECODER_OPTION, switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_MEDIA)  dispatch(events.mask, IDRIVEDECODER_MEDIA,  switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_NAV)    dispatch(events.mask, IDRIVEDECODER_NAV,    switchEvent);
+    if (Inputs & IDRIVEDECODER_INPUT_MAP)    dispatch(events.mask, IDRIVEDECODER_MAP,    switchEvent);
+  }
+
+  template<class SwitchHandler>
+  static inline void dispatch(const uint64_t& mask, const unsigned char eventId, SwitchHandler& switchEvent) {
+    const unsigned char fired = mask >> eventId & 0x07;
+
+    if (fired) {
+      switchEvent((unsigned char)(eventId + (fired >> 1)));
+    }
+  }
 
 private:
-  unsigned char  lastCounter = 0xff;
-  unsigned short lastPos     = 0x7fff;
-  unsigned char  lastSwitch0 = 0;
-  unsigned char  lastSwitch1 = 0;
-  unsigned char  lastSwitch2 = 0;
+  friend class IDriveEncoder;
+
+  Registers registers;
 
   static const unsigned char centerBit3    = 0x01;
   static const unsigned char centerExtBit3 = 0x02;
@@ -162,421 +388,332 @@ private:
   static const unsigned char mapBit7       = 0x01;
   static const unsigned char mapExtBit7    = 0x02;
 
-  inline void reset(void) {
-    lastCounter = 0xff;
-    lastPos     = 0x7fff;
-    lastSwitch0 = 0;
-    lastSwitch1 = 0;
-    lastSwitch2 = 0;
-  }
-
-  inline bool isCenter3( const unsigned char &data3 ) const {
-    return data3 & centerBit3;
-  }
-
-  inline bool isCenterExt3( const unsigned char &data3 ) const {
-    return data3 & centerExtBit3;
-  }
-
-  inline bool wasCenter(void) const {
-    return lastSwitch0 & 0x80;
-  }
-
-  inline bool wasCenterExt(void) const {
-    return lastSwitch0 & 0x40;
-  }
-
-  inline bool wasCenterOrExt(void) const {
-    return lastSwitch0 & 0xc0;
-  }
-
-  inline void setLastCenter(void) {
-    clearLastCenter();
-    lastSwitch0 |= 0x80;
-  }
-
-  inline void setLastCenterExt(void) {
-    clearLastCenter();
-    lastSwitch0 |= 0x40;
-  }
-
-  inline void clearLastCenter(void) {
-    lastSwitch0 &= 0x3f;
-  }
-
-  inline bool isLeft3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == leftBit3;
-  }
-
-  inline bool isLeftExt3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == leftExtBit3;
-  }
-
-  inline bool wasLeft(void) const {
-    return lastSwitch0 & 0x20;
-  }
-
-  inline bool wasLeftExt(void) const {
-    return lastSwitch0 & 0x10;
-  }
-
-  inline bool wasLeftOrExt(void) const {
-    return lastSwitch0 & 0x30;
-  }
-
-  inline void setLastLeft(void) {
-    clearLastLeft();
-    lastSwitch0 |= 0x20;
-  }
-
-  inline void setLastLeftExt(void) {
-    clearLastLeft();
-    lastSwitch0 |= 0x10;
-  }
-
-  inline void clearLastLeft(void) {
-    lastSwitch0 &= 0xcf;
-  }
-
-  inline bool isUp3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == upBit3;
-  }
-
-  inline bool isUpExt3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == upExtBit3;
-  }
-
-  inline bool wasUp(void) const {
-    return lastSwitch0 & 0x08;
-  }
-
-  inline bool wasUpExt(void) const {
-    return lastSwitch0 & 0x04;
-  }
-
-  inline bool wasUpOrExt(void) const {
-    return lastSwitch0 & 0x0c;
-  }
-
-  inline void setLastUp(void) {
-    clearLastUp();
-    lastSwitch0 |= 0x08;
-  }
-
-  inline void setLastUpExt(void) {
-    clearLastUp();
-    lastSwitch0 |= 0x04;
-  }
-
-  inline void clearLastUp(void) {
-    lastSwitch0 &= 0xf3;
-  }
-
-  inline bool isRight3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == rightBit3;
-  }
-
-  inline bool isRightExt3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == rightExtBit3;
-  }
-
-  inline bool wasRight(void) const {
-    return lastSwitch0 & 0x02;
-  }
-
-  inline bool wasRightExt(void) const {
-    return lastSwitch0 & 0x01;
-  }
-
-  inline bool wasRightOrExt(void) const {
-    return lastSwitch0 & 0x03;
-  }
-
-  inline void setLastRight(void) {
-    clearLastRight();
-    lastSwitch0 |= 0x02;
-  }
-
-  inline void setLastRightExt(void) {
-    clearLastRight();
-    lastSwitch0 |= 0x01;
-  }
-
-  inline void clearLastRight(void) {
-    lastSwitch0 &= 0xfc;
-  }
+  struct Input {
+    unsigned char index;      // byte of the CAN-message
+    unsigned char pressMask;
+    unsigned char pressBits;
+    unsigned char extMask;
+    unsigned char extBits;
+    unsigned char slot;       // lastSwitch[slot]
+    unsigned char stateBit;   // set while pressed, (stateBit >> 1) while long pressed
+    unsigned char eventId;    // press-event, long-press and release follow
+  };
+
+  static const unsigned char inputCount = 12;
+  static const unsigned char knobInputs = 5;
+  static const unsigned char slotInputs = 4;  // rows sharing one lastSwitch[slot]
+
+  /* one row per input in the order the events are reported:
+   * press- and long-press are detected by comparing the masked byte of the
+   * CAN-message to pressBits/extBits, press takes precedence over long-press.
+   * The first knobInputs rows (byte 3) are decoded by knobCenter/knobDirection.
+   * Rows are grouped by slot, slotInputs rows per slot in slot order.
+   */
+  static constexpr Input inputs[inputCount] PROGMEM = {
+    // index, pressMask,  pressBits,   extMask,       extBits,        slot, stateBit, eventId
+    { 3,      centerBit3, centerBit3,  centerExtBit3, centerExtBit3,  0,    0x80,     IDRIVEDECODER_CENTER },
+    { 3,      dirMask3,   leftBit3,    dirMask3,      leftExtBit3,    0,    0x20,     IDRIVEDECODER_LEFT   },
+    { 3,      dirMask3,   upBit3,      dirMask3,      upExtBit3,      0,    0x08,     IDRIVEDECODER_UP     },
+    { 3,      dirMask3,   rightBit3,   dirMask3,      rightExtBit3,   0,    0x02,     IDRIVEDECODER_RIGHT  },
+    { 3,      dirMask3,   downBit3,    dirMask3,      downExtBit3,    1,    0x80,     IDRIVEDECODER_DOWN   },
+    { 4,      menuBit4,   menuBit4,    menuExtBit4,   menuExtBit4,    1,    0x20,     IDRIVEDECODER_MENU   },
+    { 4,      backBit4,   backBit4,    backExtBit4,   backExtBit4,    1,    0x08,     IDRIVEDECODER_BACK   },
+    { 5,      comBit5,    comBit5,     comExtBit5,    comExtBit5,     1,    0x02,     IDRIVEDECODER_COM    },
+    { 5,      optionBit5, optionBit5,  optionExtBit5, optionExtBit5,  2,    0x80,     IDRIVEDECODER_OPTION },
+    { 6,      mediaBit6,  mediaBit6,   mediaExtBit6,  mediaExtBit6,   2,    0x20,     IDRIVEDECODER_MEDIA  },
+    { 6,      navBit6,    navBit6,     navExtBit6,    navExtBit6,     2,    0x08,     IDRIVEDECODER_NAV    },
+    { 7,      mapBit7,    mapBit7,     mapExtBit7,    mapExtBit7,     2,    0x02,     IDRIVEDECODER_MAP    },
+  };
+
+  // state bits of the inputs in 'enabled' that live in lastSwitch[slot]
+  static constexpr unsigned char stateMask(const uint16_t enabled, const unsigned char slot, const unsigned char row = 0) {
+    return row == inputCount ? 0
+      : ((enabled >> row & 1) && inputs[row].slot == slot ? inputs[row].stateBit | inputs[row].stateBit >> 1 : 0)
+        | stateMask(enabled, slot, row + 1);
+  }
+
+  /* decodeInputs unrolled: one instance per row of inputs, the constants are
+   * taken from the table at compile time */
+  template<uint16_t Inputs, unsigned char Index>
+  struct Row {
+    static const bool          enabled   = Inputs >> Index & 1;
+    static const unsigned char index     = inputs[Index].index;
+    static const unsigned char pressMask = inputs[Index].pressMask;
+    static const unsigned char pressBits = inputs[Index].pressBits;
+    static const unsigned char extMask   = inputs[Index].extMask;
+    static const unsigned char extBits   = inputs[Index].extBits;
+    static const unsigned char slot      = inputs[Index].slot;
+    static const unsigned char stateBit  = inputs[Index].stateBit;
+    static const unsigned char eventId   = inputs[Index].eventId;
+    static const unsigned char bits      = stateBit | stateBit >> 1;
+    static const unsigned char nextSlot  = Index % slotInputs ? Index + 1 : Index + slotInputs;
+
+    static inline void decode(const unsigned char* data, const unsigned char* delta, unsigned char (&state)[3]) {
+      if (enabled && delta[index]) {
+        unsigned char &current = state[slot];
+
+        current &= ~bits;
+        if ((data[index] & pressMask) == pressBits) {
+          current |= stateBit;
+        } else if ((data[index] & extMask) == extBits) {
+          current |= stateBit >> 1;
+        }
+      }
+
+      Row<Inputs, Index + 1>::decode(data, delta, state);
+    }
+
+    static inline void emit(const unsigned char (&state)[3], unsigned char (&lastSwitch)[3], uint64_t& mask) {
+      // the first row of a slot skips all rows of the slot if none of them changed
+      if (Index % slotInputs == 0 && state[slot] == lastSwitch[slot]) {
+        Row<Inputs, nextSlot>::emit(state, lastSwitch, mask);
+        return;
+      }
+
+      if (enabled && ((state[slot] ^ lastSwitch[slot]) & bits)) {
+        const unsigned char current = state[slot] & bits;
+
+        lastSwitch[slot] = (lastSwitch[slot] & ~bits) | current;
+        mask |= IDRIVEDECODER_EVENT(eventId + (current == stateBit ? 0 : current ? 1 : 2));
+      }
+
+      Row<Inputs, Index + 1>::emit(state, lastSwitch, mask);
+    }
+  };
+
+  template<uint16_t Inputs>
+  struct Row<Inputs, inputCount> {
+    static inline void decode(const unsigned char*, const unsigned char*, unsigned char (&)[3]) {
+    }
+
+    static inline void emit(const unsigned char (&)[3], unsigned char (&)[3], uint64_t&) {
+    }
+  };
+
+  // false if only counter or rotary differ from the last CAN-message
+  static inline bool inputsChanged(const unsigned char* delta) {
+    return delta[3] | delta[4] | delta[5] | delta[6] | delta[7];
+  }
+
+  /* counter, idle and rotary part of decode, returns its status */
+  static unsigned char accept(const unsigned char* data, Registers& registers, IDriveEvents& events, uint64_t& changed);
+
+  static const unsigned char  knobCenter[4];
+  static const unsigned short knobDirection[16];
 
-  inline bool isDown3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == downBit3;
-  }
-
-  inline bool isDownExt3( const unsigned char &data3 ) const {
-    return (data3 & dirMask3) == downExtBit3;
-  }
-
-  inline bool wasDown(void) const {
-    return lastSwitch1 & 0x80;
-  }
-
-  inline bool wasDownExt(void) const {
-    return lastSwitch1 & 0x40;
-  }
-
-  inline bool wasDownOrExt(void) const {
-    return lastSwitch1 & 0xc0;
-  }
-
-  inline void setLastDown(void) {
-    clearLastDown();
-    lastSwitch1 |= 0x80;
-  }
-
-  inline void setLastDownExt(void) {
-    clearLastDown();
-    lastSwitch1 |= 0x40;
-  }
-
-  inline void clearLastDown(void) {
-    lastSwitch1 &= 0x3f;
-  }
-
-  inline bool isMenu4( const unsigned char &data4 ) const {
-    return data4 & menuBit4;
-  }
-
-  inline bool isMenuExt4( const unsigned char &data4 ) const {
-    return data4 & menuExtBit4;
-  }
-
-  inline bool wasMenu(void) const {
-    return lastSwitch1 & 0x20;
-  }
-
-  inline bool wasMenuExt(void) const {
-    return lastSwitch1 & 0x10;
-  }
-
-  inline bool wasMenuOrExt(void) const {
-    return lastSwitch1 & 0x30;
-  }
-
-  inline void setLastMenu(void) {
-    clearLastMenu();
-    lastSwitch1 |= 0x20;
-  }
-
-  inline void setLastMenuExt(void) {
-    clearLastMenu();
-    lastSwitch1 |= 0x10;
-  }
-
-  inline void clearLastMenu(void) {
-    lastSwitch1 &= 0xcf;
-  }
-
-  inline bool isBack4( const unsigned char &data4 ) const {
-    return data4 & backBit4;
-  }
-
-  inline bool isBackExt4( const unsigned char &data4 ) const {
-    return data4 & backExtBit4;
-  }
-
-  inline bool wasBack(void) const {
-    return lastSwitch1 & 0x08;
-  }
-
-  inline bool wasBackExt(void) const {
-    return lastSwitch1 & 0x04;
-  }
-
-  inline bool wasBackOrExt(void) const {
-    return lastSwitch1 & 0x0c;
-  }
-
-  inline void setLastBack(void) {
-    clearLastBack();
-    lastSwitch1 |= 0x08;
-  }
-
-  inline void setLastBackExt(void) {
-    clearLastBack();
-    lastSwitch1 |= 0x04;
-  }
-
-  inline void clearLastBack(void) {
-    lastSwitch1 &= 0xf3;
-  }
-
-  inline bool isCom5( const unsigned char &data5 ) const {
-    return data5 & comBit5;
-  }
-
-  inline bool isComExt5( const unsigned char &data5 ) const {
-    return data5 & comExtBit5;
-  }
-
-  inline bool wasCom(void) const {
-    return lastSwitch1 & 0x02;
-  }
-
-  inline bool wasComExt(void) const {
-    return lastSwitch1 & 0x01;
-  }
-
-  inline bool wasComOrExt(void) const {
-    return lastSwitch1 & 0x03;
-  }
-
-  inline void setLastCom(void) {
-    clearLastCom();
-    lastSwitch1 |= 0x02;
-  }
-
-  inline void setLastComExt(void) {
-    clearLastCom();
-    lastSwitch1 |= 0x01;
-  }
-
-  inline void clearLastCom(void) {
-    lastSwitch1 &= 0xfc;
+  inline void reset(void) {
+    reset(registers);
   }
+};
 
-  inline bool isOption5( const unsigned char &data5 ) const {
-    return data5 & optionBit5;
+/* statistics policy of BasicIDriveDecoder that counts nothing and takes no space */
+struct IDriveNoStats {
+  inline void count(const unsigned char, const unsigned char, const unsigned char, const IDriveEvents&) {
   }
+};
 
-  inline bool isOptionExt5( const unsigned char &data5 ) const {
-    return data5 & optionExtBit5;
+/* statistics policy that counts every CAN-message passed to decode */
+struct IDriveDecoderStats {
+  uint32_t frames;   // all messages
+  uint32_t stale;    // ignored, counter behind the last one
+  uint32_t resets;   // counter 0
+  uint32_t idle;     // accepted, same as the previous message
+  uint32_t gaps;     // accepted after one or more missing counters
+  uint32_t lost;     // sum of the missing counters
+  uint32_t events[IDRIVEDECODER_OPTION_REL + 1];  // per eventId, rotary moves at IDRIVEDECODER_ROTARY
+
+  IDriveDecoderStats() {
+    memset(this, 0, sizeof(*this));
+  }
+
+  /* status as returned by decode, counters before and of the message */
+  inline void count(const unsigned char status, const unsigned char previous, const unsigned char counter, const IDriveEvents& result) {
+    frames++;
+
+    if (status & IDRIVEDECODER_STALE) {
+      stale++;
+      return;
+    }
+
+    if (status & IDRIVEDECODER_RESET) {
+      resets++;
+    } else if (!(status & IDRIVEDECODER_FIRST)) {
+      // the counter before the first message is not known. Counters go 0xff -> 1, 0 only ever comes with a reset
+      const unsigned char missing = (unsigned char)(counter - previous - 1) - (counter < previous);
+      if (missing && missing < 0x7f) {
+        gaps++;
+        lost += missing;
+      }
+    }
+
+    if (status & IDRIVEDECODER_IDLE) {
+      idle++;
+      return;
+    }
+
+    if (result.rotary) {
+      events[IDRIVEDECODER_ROTARY]++;
+    }
+
+    for (uint64_t mask = result.mask; mask; mask &= mask - 1) {
+      events[__builtin_ctzll(mask)]++;
+    }
   }
+};
 
-  inline bool wasOption(void) const {
-    return lastSwitch2 & 0x80;
+/* tracing policy of BasicIDriveDecoder that measures nothing and takes no space */
+struct IDriveNoTrace {
+  inline void arrived(void) {
   }
 
-  inline bool wasOptionExt(void) const {
-    return lastSwitch2 & 0x40;
+  inline void decoded(void) {
   }
 
-  inline bool wasOptionOrExt(void) const {
-    return lastSwitch2 & 0xc0;
+  inline void handled(void) {
   }
 
-  inline void setLastOption(void) {
-    clearLastOption();
-    lastSwitch2 |= 0x80;
+  inline void finished(const bool) {
   }
+};
 
-  inline void setLastOptionExt(void) {
-    clearLastOption();
-    lastSwitch2 |= 0x40;
-  }
+// value is true if A and B are the same type
+template<class A, class B>
+struct IDriveSameType {
+  static const bool value = false;
+};
 
-  inline void clearLastOption(void) {
-    lastSwitch2 &= 0x3f;
-  }
+template<class A>
+struct IDriveSameType<A, A> {
+  static const bool value = true;
+};
 
-  inline bool isMedia6( const unsigned char &data6 ) const {
-    return data6 & mediaBit6;
-  }
+/* calls switchEvent(eventId) and rotaryEvent(delta) for the events of each
+ * CAN-message. Handlers may be function references, function pointers or any
+ * functor or lambda type, they are called directly and can be inlined.
+ * Stats is IDriveNoStats or IDriveDecoderStats, Trace is IDriveNoTrace or an
+ * IDriveLatencyTrace (IDriveLatencyTrace.h). Inputs selects the inputs to
+ * decode, see IDriveDecoderCore::decodeInputs.
+ */
+template<class SwitchHandler, class RotaryHandler, class Stats = IDriveNoStats, class Trace = IDriveNoTrace, uint16_t Inputs = IDRIVEDECODER_INPUT_ALL>
+class BasicIDriveDecoder : public IDriveDecoderCore, private Stats, private Trace {
+public:
 
-  inline bool isMediaExt6( const unsigned char &data6 ) const {
-    return data6 & mediaExtBit6;
-  }
+  SwitchHandler switchEvent;
+  RotaryHandler rotaryEvent;
 
-  inline bool wasMedia(void) const {
-    return lastSwitch2 & 0x20;
+  BasicIDriveDecoder(SwitchHandler switchEvent, RotaryHandler rotaryEvent):switchEvent(switchEvent),rotaryEvent(rotaryEvent) {
   }
 
-  inline bool wasMediaExt(void) const {
-    return lastSwitch2 & 0x10;
-  }
+  /* decode without callbacks, for the inputs in Inputs only and counted
+   * and traced like decode(data) */
+  inline unsigned char decode(const unsigned char* data, IDriveEvents& events) {
+    Trace::arrived();
 
-  inline bool wasMediaOrExt(void) const {
-    return lastSwitch2 & 0x30;
-  }
+    const unsigned char previous = counter();
+    const unsigned char status   = decodeInputs<Inputs>(data, events);
 
-  inline void setLastMedia(void) {
-    clearLastMedia();
-    lastSwitch2 |= 0x20;
-  }
+    Trace::decoded();
+    Stats::count(status, previous, data[0], events);
+    Trace::finished(events.mask || events.rotary);
 
-  inline void setLastMediaExt(void) {
-    clearLastMedia();
-    lastSwitch2 |= 0x10;
+    return status;
   }
 
-  inline void clearLastMedia(void) {
-    lastSwitch2 &= 0xcf;
-  }
+  /* decodeBatch for the inputs in Inputs only, counted and traced per
+   * message like decode(data). Only the default decoder skips idle repeats
+   * without looking at each of them. */
+  size_t decodeBatch(const uint8_t (*frames)[8], size_t n, IDriveEventSink& sink) {
 
-  inline bool isNav6( const unsigned char &data6 ) const {
-    return data6 & navBit6;
-  }
+    if (Inputs == IDRIVEDECODER_INPUT_ALL && IDriveSameType<Stats, IDriveNoStats>::value && IDriveSameType<Trace, IDriveNoTrace>::value) {
+      return IDriveDecoderCore::decodeBatch(frames, n, sink);
+    }
 
-  inline bool isNavExt6( const unsigned char &data6 ) const {
-    return data6 & navExtBit6;
-  }
+    for (size_t i = 0; i < n; i++) {
+      if (sink.capacity - sink.count < IDRIVEDECODER_MAX_EVENTS) {
+        return i;
+      }
 
-  inline bool wasNav(void) const {
-    return lastSwitch2 & 0x08;
-  }
+      IDriveEvents events;
+      decode(frames[i], events);
 
-  inline bool wasNavExt(void) const {
-    return lastSwitch2 & 0x04;
-  }
+      if (events.rotary || events.mask) {
+        record(events, i, sink);
+      }
+    }
 
-  inline bool wasNavOrExt(void) const {
-    return lastSwitch2 & 0x0c;
+    return n;
   }
 
-  inline void setLastNav(void) {
-    clearLastNav();
-    lastSwitch2 |= 0x08;
-  }
+  inline void decode(const unsigned char* data) {
+    Trace::arrived();
 
-  inline void setLastNavExt(void) {
-    clearLastNav();
-    lastSwitch2 |= 0x04;
-  }
+    IDriveEvents events;
+    const unsigned char previous = counter();
+    const unsigned char status   = decodeInputs<Inputs>(data, events);
 
-  inline void clearLastNav(void) {
-    lastSwitch2 &= 0xf3;
-  }
+    Trace::decoded();
+    Stats::count(status, previous, data[0], events);
 
-  inline bool isMap7( const unsigned char &data7 ) const {
-    return data7 & mapBit7;
-  }
+    Traced<SwitchHandler> switchTraced(switchEvent, *this);
+    Traced<RotaryHandler> rotaryTraced(rotaryEvent, *this);
+    dispatch<Inputs>(events, switchTraced, rotaryTraced);
 
-  inline bool isMapExt7( const unsigned char &data7 ) const {
-    return data7 & mapExtBit7;
+    Trace::finished(events.mask || events.rotary);
   }
 
-  inline bool wasMap(void) const {
-    return lastSwitch2 & 0x02;
+  inline const Stats& stats(void) const {
+    return *this;
   }
 
-  inline bool wasMapExt(void) const {
-    return lastSwitch2 & 0x01;
+  inline Stats& stats(void) {
+    return *this;
   }
 
-  inline bool wasMapOrExt(void) const {
-    return lastSwitch2 & 0x03;
+  inline const Trace& trace(void) const {
+    return *this;
   }
 
-  inline void setLastMap(void) {
-    clearLastMap();
-    lastSwitch2 |= 0x02;
+  inline Trace& trace(void) {
+    return *this;
   }
 
-  inline void setLastMapExt(void) {
-    clearLastMap();
-    lastSwitch2 |= 0x01;
-  }
+private:
 
-  inline void clearLastMap(void) {
-    lastSwitch2 &= 0xfc;
-  }
+  // calls the handler, then Trace::handled
+  template<class Handler>
+  struct Traced {
+    Handler& handler;
+    Trace&   trace;
+
+    Traced(Handler& handler, Trace& trace):handler(handler),trace(trace) {
+    }
+
+    template<class Value>
+    inline void operator()(const Value value) {
+      handler(value);
+      trace.handled();
+    }
+  };
 };
 
+typedef BasicIDriveDecoder<const void (&)(const unsigned char&), const void (&)(const short&)> IDriveDecoder;
+
+template<class SwitchHandler, class RotaryHandler>
+inline BasicIDriveDecoder<SwitchHandler, RotaryHandler> makeIDriveDecoder(SwitchHandler switchEvent, RotaryHandler rotaryEvent) {
+  return BasicIDriveDecoder<SwitchHandler, RotaryHandler>(switchEvent, rotaryEvent);
+}
+
+/* makeIDriveDecoder<IDRIVEDECODER_INPUT_KNOB | IDRIVEDECODER_INPUT_MENU>(switchEvent, rotaryEvent) */
+template<uint16_t Inputs, class SwitchHandler, class RotaryHandler>
+inline BasicIDriveDecoder<SwitchHandler, RotaryHandler, IDriveNoStats, IDriveNoTrace, Inputs> makeIDriveDecoder(SwitchHandler switchEvent, RotaryHandler rotaryEvent) {
+  return BasicIDriveDecoder<SwitchHandler, RotaryHandler, IDriveNoStats, IDriveNoTrace, Inputs>(switchEvent, rotaryEvent);
+}
+
+/* makeIDriveDecoder<IDriveDecoderStats>(switchEvent, rotaryEvent) or
+ * makeIDriveDecoder<IDriveNoStats, IDriveLatencyTrace<Clock> >(...) */
+template<class Stats, class Trace = IDriveNoTrace, class SwitchHandler, class RotaryHandler>
+inline BasicIDriveDecoder<SwitchHandler, RotaryHandler, Stats, Trace> makeIDriveDecoder(SwitchHandler switchEvent, RotaryHandler rotaryEvent) {
+  return BasicIDriveDecoder<SwitchHandler, RotaryHandler, Stats, Trace>(switchEvent, rotaryEvent);
+}
+
 #endif /* IDRIVEDECODER_H_ */
@@ -0,0 +1,174 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEDECODERBANK_H_
+#define IDRIVEDECODERBANK_H_
+
+#include "IDriveDecoder.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* decoders for up to Slots controllers, each on its own CAN id.
+ *
+ * The state of all controllers is kept in one array per field (11 bytes per
+ * controller plus its id), the position of the rotary is not stored twice
+ * as it is part of the last frame. CAN ids map to slots through an open
+ * addressing hash table with at least twice as many entries as slots.
+ */
+template<unsigned short Slots>
+class IDriveDecoderBank {
+public:
+
+  static_assert(Slots > 0 && Slots <= 16384, "IDriveDecoderBank supports 1 to 16384 slots");
+
+  IDriveDecoderBank():used(0) {
+    memset(table, 0, sizeof(table));
+  }
+
+  inline unsigned short size(void) const {
+    return used;
+  }
+
+  inline uint32_t canId(const unsigned short slot) const {
+    return ids[slot];
+  }
+
+  /* slot of canId, registers the id with a freshly reset decoder if it is
+   * new. Returns -1 once all Slots are taken.
+   */
+  int add(const uint32_t canId) {
+    unsigned short entry = find(canId);
+
+    if (table[entry]) {
+      return table[entry] - 1;
+    }
+
+    if (used == Slots) {
+      return -1;
+    }
+
+    const unsigned short slot = used++;
+    table[entry] = slot + 1;
+    ids[slot]    = canId;
+    reset(slot);
+    return slot;
+  }
+
+  /* -1 for an id that was never added */
+  inline int slot(const uint32_t canId) const {
+    return (int)table[find(canId)] - 1;
+  }
+
+  void reset(const unsigned short slot) {
+    IDriveDecoderCore::Registers registers;
+    IDriveDecoderCore::reset(registers);
+    store(slot, registers);
+  }
+
+  void decodeSlot(const unsigned short slot, const unsigned char* data, IDriveEvents& events) {
+    IDriveDecoderCore::Registers registers;
+    load(slot, registers);
+    IDriveDecoderCore::decode(data, registers, events);
+    store(slot, registers);
+  }
+
+  /* decodes a CAN-message of any added id, returns its slot or -1 (no
+   * events) for an unknown id */
+  inline int decode(const uint32_t canId, const unsigned char* data, IDriveEvents& events) {
+    const int found = slot(canId);
+
+    if (found < 0) {
+      events.mask   = 0;
+      events.rotary = 0;
+      return -1;
+    }
+
+    decodeSlot(found, data, events);
+    return found;
+  }
+
+  /* decodes n CAN-messages with mixed ids like IDriveDecoderCore::decodeBatch,
+   * the controller of a record is canIds[record.frame]. Unknown ids are skipped.
+   */
+  size_t decodeBatch(const uint32_t* canIds, const uint8_t (*frames)[8], size_t n, IDriveEventSink& sink) {
+    for (size_t i = 0; i < n; i++) {
+      if (sink.capacity - sink.count < IDRIVEDECODER_MAX_EVENTS) {
+        return i;
+      }
+
+      IDriveEvents events;
+
+      if (decode(canIds[i], frames[i], events) >= 0 && (events.rotary || events.mask)) {
+        IDriveDecoderCore::record(events, i, sink);
+      }
+    }
+
+    return n;
+  }
+
+private:
+
+  static constexpr unsigned char tableBits(const unsigned long entries, const unsigned char bits = 1) {
+    return (1ul << bits) >= entries ? bits : tableBits(entries, bits + 1);
+  }
+
+  static const unsigned char  hashBits  = tableBits(2ul * Slots);
+  static const unsigned short tableSize = 1u << hashBits;
+
+  uint64_t       frames[Slots];
+  uint32_t       ids[Slots];
+  unsigned char  counters[Slots];
+  unsigned char  switches[3][Slots];
+  unsigned short table[tableSize];   // slot + 1, 0 for a free entry
+  unsigned short used;
+
+  // entry of canId or the free entry it would go to, the table is never full
+  inline unsigned short find(const uint32_t canId) const {
+    unsigned short entry = (uint32_t)(canId * 0x9e3779b1ul) >> (32 - hashBits);
+
+    while (table[entry] && ids[table[entry] - 1] != canId) {
+      entry = (entry + 1) & (tableSize - 1);
+    }
+
+    return entry;
+  }
+
+  inline void load(const unsigned short slot, IDriveDecoderCore::Registers& registers) const {
+    const unsigned char *frame = reinterpret_cast<const unsigned char*>(&frames[slot]);
+
+    registers.frame       = frames[slot];
+    registers.pos         = frame[2] << 8 | frame[1];
+    registers.counter     = counters[slot];
+    registers.switches[0] = switches[0][slot];
+    registers.switches[1] = switches[1][slot];
+    registers.switches[2] = switches[2][slot];
+  }
+
+  inline void store(const unsigned short slot, const IDriveDecoderCore::Registers& registers) {
+    frames[slot]      = registers.frame;
+    counters[slot]    = registers.counter;
+    switches[0][slot] = registers.switches[0];
+    switches[1][slot] = registers.switches[1];
+    switches[2][slot] = registers.switches[2];
+  }
+};
+
+#endif /* IDRIVEDECODERBANK_H_ */
@@ -0,0 +1,135 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveDecoderSimd.h"
+
+#include <string.h>
+
+size_t IDriveDecoderSimd::idleRunScalar(const uint8_t (*frames)[8], size_t n) {
+
+  for (size_t i = 0; i < n; i++) {
+    const uint8_t *frame    = frames[i];
+    const uint8_t *previous = frame - 8;
+
+    if (frame[0] == 0 || (uint8_t)(frame[0] - previous[0]) > 0x7f || memcmp(frame + 1, previous + 1, 7)) {
+      return i;
+    }
+  }
+
+  return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+/* each byte of a frame compares to the same byte of its predecessor. Bytes 1-7
+ * have to be equal, byte 0 (counter) must be non-zero and ahead by 0..0x7f.
+ * movemask yields one bit per byte, a frame is idle if all 8 of its bits are set.
+ */
+
+__attribute__((target("avx2")))
+static size_t idleRunAvx2(const uint8_t (*frames)[8], size_t n) {
+
+  const __m256i counter = _mm256_set1_epi64x(0xff);
+  const __m256i zero    = _mm256_setzero_si256();
+  const __m256i ones    = _mm256_set1_epi8(-1);
+
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    const uint8_t *frame = frames[i];
+    const __m256i current  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(frame));
+    const __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(frame - 8));
+
+    const __m256i equal   = _mm256_cmpeq_epi8(current, previous);
+    const __m256i fresh   = _mm256_cmpgt_epi8(_mm256_sub_epi8(current, previous), ones);
+    const __m256i nonzero = _mm256_andnot_si256(_mm256_cmpeq_epi8(current, zero), ones);
+    const __m256i idle    = _mm256_blendv_epi8(equal, _mm256_and_si256(fresh, nonzero), counter);
+
+    const uint32_t busy = ~(uint32_t)_mm256_movemask_epi8(idle);
+
+    if (busy) {
+      return i + (__builtin_ctz(busy) >> 3);
+    }
+  }
+
+  return i + IDriveDecoderSimd::idleRunScalar(frames + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t idleRunSse2(const uint8_t (*frames)[8], size_t n) {
+
+  const __m128i counter = _mm_set_epi32(0, 0xff, 0, 0xff);
+  const __m128i zero    = _mm_setzero_si128();
+  const __m128i ones    = _mm_set1_epi8(-1);
+
+  size_t i = 0;
+
+  for (; i + 2 <= n; i += 2) {
+    const uint8_t *frame = frames[i];
+    const __m128i current  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame));
+    const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame - 8));
+
+    const __m128i equal   = _mm_cmpeq_epi8(current, previous);
+    const __m128i fresh   = _mm_cmpgt_epi8(_mm_sub_epi8(current, previous), ones);
+    const __m128i nonzero = _mm_andnot_si128(_mm_cmpeq_epi8(current, zero), ones);
+    const __m128i idle    = _mm_or_si128(_mm_andnot_si128(counter, equal), _mm_and_si128(counter, _mm_and_si128(fresh, nonzero)));
+
+    const uint32_t busy = ~(uint32_t)_mm_movemask_epi8(idle) & 0xffff;
+
+    if (busy) {
+      return i + (__builtin_ctz(busy) >> 3);
+    }
+  }
+
+  return i + IDriveDecoderSimd::idleRunScalar(frames + i, n - i);
+}
+
+typedef size_t (*IDriveIdleRun)(const uint8_t (*frames)[8], size_t n);
+
+static IDriveIdleRun selectIdleRun(void) {
+
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    return idleRunAvx2;
+  }
+
+  if (__builtin_cpu_supports("sse2")) {
+    return idleRunSse2;
+  }
+
+  return IDriveDecoderSimd::idleRunScalar;
+}
+
+size_t IDriveDecoderSimd::idleRun(const uint8_t (*frames)[8], size_t n) {
+
+  static const IDriveIdleRun run = selectIdleRun();
+
+  return run(frames, n);
+}
+
+#else
+
+size_t IDriveDecoderSimd::idleRun(const uint8_t (*frames)[8], size_t n) {
+  return idleRunScalar(frames, n);
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEDECODERSIMD_H_
+#define IDRIVEDECODERSIMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* scans captured CAN-messages for idle repeats. Uses AVX2 or SSE2 when the
+ * CPU supports it (selected at runtime on x86) and plain C++ everywhere else.
+ */
+class IDriveDecoderSimd {
+public:
+
+  /* returns the number of leading frames that repeat their predecessor:
+   * bytes 1-7 equal, counter not 0 and not stale compared to the counter of
+   * the predecessor. frames[-1] must be valid.
+   */
+  static size_t idleRun(const uint8_t (*frames)[8], size_t n);
+
+  static size_t idleRunScalar(const uint8_t (*frames)[8], size_t n);
+};
+
+#endif /* IDRIVEDECODERSIMD_H_ */
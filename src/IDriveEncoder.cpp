@@ -0,0 +1,89 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveEncoder.h"
+#include "IDrivePgmSpace.h"
+
+IDriveEncoder::IDriveEncoder() {
+  // the 'Release' message
+  frame[0] = 0x00;
+  frame[1] = 0xff;
+  frame[2] = 0x7f;
+  frame[3] = 0x00;
+  frame[4] = 0x00;
+  frame[5] = 0x00;
+  frame[6] = 0xc0;
+  frame[7] = 0xf8;
+}
+
+void IDriveEncoder::apply(const unsigned char eventId) {
+
+  if (eventId < IDRIVEDECODER_CENTER || eventId > IDRIVEDECODER_OPTION_REL) {
+    return;
+  }
+
+  const unsigned char pressId = eventId - (eventId - IDRIVEDECODER_CENTER) % 3;
+
+  for (unsigned char i = 0; i < IDriveDecoderCore::inputCount; i++) {
+    IDriveDecoderCore::Input input;
+    memcpy_P(&input, &IDriveDecoderCore::inputs[i], sizeof(input));
+
+    if (input.eventId != pressId) {
+      continue;
+    }
+
+    unsigned char &value = frame[input.index];
+    const bool active = (value & input.pressMask) == input.pressBits || (value & input.extMask) == input.extBits;
+
+    // the knob directions share their bits, releasing one must not release another
+    if (eventId == pressId + 2 && !active) {
+      return;
+    }
+
+    value &= ~(input.pressMask | input.extMask);
+
+    if (eventId == pressId) {
+      value |= input.pressBits;
+    } else if (eventId == pressId + 1) {
+      value |= input.extBits;
+    }
+    return;
+  }
+}
+
+size_t IDriveEncoder::encode(const IDriveAction* script, size_t steps, uint8_t (*frames)[8], size_t n) {
+
+  size_t count = 0;
+
+  for (size_t i = 0; i < steps; i++) {
+    const IDriveAction &action = script[i];
+
+    apply(action.eventId);
+    rotate(action.rotary);
+
+    for (unsigned short f = 0; f < action.frames; f++) {
+      if (count == n) {
+        return count;
+      }
+      encode(frames[count++]);
+    }
+  }
+
+  return count;
+}
@@ -0,0 +1,77 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEENCODER_H_
+#define IDRIVEENCODER_H_
+
+#include "IDriveDecoder.h"
+
+#include <string.h>
+
+/* one step of an encoder script: apply eventId (0 for none), move the rotary
+ * by 'rotary', then write 'frames' CAN-messages with that state.
+ */
+struct IDriveAction {
+  unsigned char  eventId;  // IDRIVEDECODER_* press, long-press or release
+  short          rotary;
+  unsigned short frames;
+};
+
+/* the inverse of IDriveDecoder: builds valid 0x25B CAN-messages from button
+ * and rotary actions, e.g. to feed benchmarks and soak-tests of the decoder.
+ *
+ * The first message has counter 0, later ones count 1..0xff and wrap to 1 so
+ * that only restart() makes the decoder reset. The rotary starts at 0x7fff,
+ * the position a freshly reset decoder assumes.
+ */
+class IDriveEncoder {
+public:
+
+  IDriveEncoder();
+
+  /* press (IDRIVEDECODER_X), long-press (IDRIVEDECODER_X_EXT) or release
+   * (IDRIVEDECODER_X_REL) an input, other ids are ignored */
+  void apply(const unsigned char eventId);
+
+  inline void rotate(const short delta) {
+    const unsigned short pos = (frame[2] << 8 | frame[1]) + delta;
+    frame[1] = pos;
+    frame[2] = pos >> 8;
+  }
+
+  /* the next message carries counter 0 like after a restart of the controller */
+  inline void restart(void) {
+    frame[0] = 0;
+  }
+
+  /* writes the current state as one CAN-message and advances the counter */
+  inline void encode(unsigned char* data) {
+    memcpy(data, frame, sizeof(frame));
+    frame[0] = frame[0] == 0xff ? 1 : frame[0] + 1;
+  }
+
+  /* runs a script, returns the number of messages written to frames. Stops
+   * when frames is full. */
+  size_t encode(const IDriveAction* script, size_t steps, uint8_t (*frames)[8], size_t n);
+
+private:
+  unsigned char frame[8];
+};
+
+#endif /* IDRIVEENCODER_H_ */
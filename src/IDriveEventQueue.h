@@ -0,0 +1,110 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEEVENTQUEUE_H_
+#define IDRIVEEVENTQUEUE_H_
+
+#include "IDriveDecoder.h"
+
+/* single-core MCUs only need to keep the compiler from reordering */
+#if defined(__AVR__)
+#define IDRIVEEVENTQUEUE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define IDRIVEEVENTQUEUE_BARRIER() __sync_synchronize()
+#endif
+
+struct IDriveEvent {
+  unsigned char eventId;  // IDRIVEDECODER_ROTARY or one of IDRIVEDECODER_*
+  short         value;    // change of the rotary position for IDRIVEDECODER_ROTARY
+};
+
+/* lock-free single-producer/single-consumer queue of decoded events, e.g.
+ * filled by decode() in an interrupt handler and drained by loop(). Use it as
+ * both handlers of a decoder:
+ *
+ *   IDriveEventQueue<16> events;
+ *   BasicIDriveDecoder<IDriveEventQueue<16>&, IDriveEventQueue<16>&> IDrive(events, events);
+ *
+ * Capacity must be a power of two up to 128.
+ */
+template<unsigned char Capacity>
+class IDriveEventQueue {
+public:
+
+  static_assert(Capacity && Capacity <= 128 && !(Capacity & (Capacity - 1)), "Capacity must be a power of two up to 128");
+
+  // events lost because the queue was full, stops at 255. Written by the
+  // producer, a single byte so the consumer reads it without tearing
+  volatile unsigned char dropped = 0;
+
+  inline void operator()(const unsigned char eventId) {
+    push(eventId, 0);
+  }
+
+  inline void operator()(const short rotary) {
+    push(IDRIVEDECODER_ROTARY, rotary);
+  }
+
+  /* producer side */
+  inline bool push(const unsigned char eventId, const short value) {
+    const unsigned char h = head;
+
+    if ((unsigned char)(h - tail) == Capacity) {
+      if (dropped != 0xff) {
+        dropped = dropped + 1;
+      }
+      return false;
+    }
+
+    IDriveEvent &event = events[h & (Capacity - 1)];
+    event.eventId = eventId;
+    event.value   = value;
+
+    IDRIVEEVENTQUEUE_BARRIER();
+    head = h + 1;
+    return true;
+  }
+
+  /* consumer side */
+  inline bool pop(IDriveEvent& event) {
+    const unsigned char t = tail;
+
+    if (t == head) {
+      return false;
+    }
+
+    IDRIVEEVENTQUEUE_BARRIER();
+    event = events[t & (Capacity - 1)];
+
+    IDRIVEEVENTQUEUE_BARRIER();
+    tail = t + 1;
+    return true;
+  }
+
+  inline unsigned char size(void) const {
+    return head - tail;
+  }
+
+private:
+  IDriveEvent            events[Capacity] = {};
+  volatile unsigned char head = 0;  // written by the producer only
+  volatile unsigned char tail = 0;  // written by the consumer only
+};
+
+#endif /* IDRIVEEVENTQUEUE_H_ */
@@ -0,0 +1,188 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEEVENTSTREAM_H_
+#define IDRIVEEVENTSTREAM_H_
+
+#include "IDriveDecoder.h"
+
+#include <stdint.h>
+
+/* compact binary encoding of decoded events, e.g. for a serial link:
+ *
+ *   status  1 t i i i i i i   i: eventId, t: a time delta follows
+ *   delta   0 c d d d d d d   ticks since the previous event, 6 bits per
+ *   ...                       byte, low bits first, c: another byte follows
+ *   value   0 c v v v v v v   IDRIVEDECODER_ROTARY only: the rotary delta
+ *   ...                       zigzag encoded (0, -1, 1, -2, ...) like delta
+ *
+ * Only status bytes have the high bit set, so a receiver that lost bytes
+ * picks up again at the next event. A press in the same tick as the event
+ * before it takes 1 byte, otherwise 2 for up to 63 ticks and 3 for up to
+ * 4095. A rotary event takes one more byte for moves of -32..31, so one
+ * 100 ticks after the previous event takes 4. IDRIVESTREAM_SYNC restarts
+ * the time at 0, the encoder sends it before its first event.
+ */
+#define IDRIVESTREAM_SYNC      0xff
+#define IDRIVESTREAM_MAX_BYTES 10   // status, 6 bytes of delta, 3 of value
+
+class IDriveStreamEncoder {
+public:
+
+  IDriveStreamEncoder():last(0),synced(false) {
+  }
+
+  /* the next event is preceded by IDRIVESTREAM_SYNC */
+  inline void sync(void) {
+    synced = false;
+  }
+
+  /* writes one event to buffer (IDRIVESTREAM_MAX_BYTES), returns the number
+   * of bytes. now may come from any clock that counts up, e.g. millis().
+   */
+  unsigned char encode(const unsigned char eventId, const short value, const unsigned long now, unsigned char* buffer) {
+    unsigned char n = 0;
+
+    if (!synced) {
+      buffer[n++] = IDRIVESTREAM_SYNC;
+      last   = now;
+      synced = true;
+    }
+
+    const uint32_t delta = now - last;
+    last = now;
+
+    buffer[n++] = 0x80 | (delta ? 0x40 : 0) | (eventId & 0x3f);
+
+    if (delta) {
+      n += write(delta, buffer + n);
+    }
+
+    if (eventId == IDRIVEDECODER_ROTARY) {
+      n += write((uint16_t)(value << 1) ^ (uint16_t)(value >> 15), buffer + n);
+    }
+
+    return n;
+  }
+
+private:
+  unsigned long last;
+  bool          synced;
+
+  static inline unsigned char write(uint32_t value, unsigned char* buffer) {
+    unsigned char n = 0;
+
+    while (value >= 0x40) {
+      buffer[n++] = 0x40 | (value & 0x3f);
+      value >>= 6;
+    }
+    buffer[n++] = value;
+
+    return n;
+  }
+};
+
+/* turns the bytes of an IDriveStreamEncoder back into events */
+class IDriveStreamDecoder {
+public:
+
+  unsigned char eventId;  // of the last complete event
+  short         value;    // rotary delta for IDRIVEDECODER_ROTARY
+  uint32_t      time;     // ticks since the last IDRIVESTREAM_SYNC
+  unsigned long errors;   // events cut short, bytes outside of an event or unknown eventIds
+
+  IDriveStreamDecoder():eventId(0),value(0),time(0),errors(0),stage(idle),accumulated(0),shift(0) {
+  }
+
+  /* feeds one byte, returns true when it completed an event */
+  bool push(const unsigned char byte) {
+
+    if (byte & 0x80) {
+      if (stage != idle) {
+        errors++;
+      }
+
+      stage = idle;
+
+      if (byte == IDRIVESTREAM_SYNC) {
+        time = 0;
+        return false;
+      }
+
+      eventId     = byte & 0x3f;
+      value       = 0;
+      accumulated = 0;
+      shift       = 0;
+
+      // a corrupted status byte, its bytes are dropped up to the next one
+      if (eventId > IDRIVEDECODER_OPTION_REL) {
+        errors++;
+        eventId = 0;
+        return false;
+      }
+
+      if (byte & 0x40) {
+        stage = delta;
+      } else if (eventId == IDRIVEDECODER_ROTARY) {
+        stage = rotary;
+      } else {
+        return true;
+      }
+      return false;
+    }
+
+    if (stage == idle || shift > 30) {
+      errors++;
+      stage = idle;
+      return false;
+    }
+
+    accumulated |= (uint32_t)(byte & 0x3f) << shift;
+    shift += 6;
+
+    if (byte & 0x40) {
+      return false;
+    }
+
+    if (stage == delta) {
+      time       += accumulated;
+      accumulated = 0;
+      shift       = 0;
+
+      if (eventId == IDRIVEDECODER_ROTARY) {
+        stage = rotary;
+        return false;
+      }
+    } else {
+      value = (short)((accumulated >> 1) ^ (0 - (accumulated & 1)));
+    }
+
+    stage = idle;
+    return true;
+  }
+
+private:
+  enum Stage { idle, delta, rotary };
+
+  Stage         stage;
+  uint32_t      accumulated;
+  unsigned char shift;
+};
+
+#endif /* IDRIVEEVENTSTREAM_H_ */
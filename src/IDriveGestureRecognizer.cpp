@@ -0,0 +1,46 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveGestureRecognizer.h"
+
+IDriveGestureRecognizer::IDriveGestureRecognizer(const IDriveGesture* gestures, const unsigned char count, const unsigned long interval):gestures(gestures),count(count),interval(interval),triggers(0),doubles(0),turning(0),held(0),armed(0) {
+
+  for (unsigned char i = 0; i < count; i++) {
+    const uint64_t button = IDRIVEDECODER_EVENT(gestures[i].button);
+
+    switch (gestures[i].type) {
+      case IDRIVEGESTURE_DOUBLE:
+        doubles  |= button;
+        triggers |= button;
+        break;
+
+      case IDRIVEGESTURE_CHORD:
+        triggers |= button | IDRIVEDECODER_EVENT(gestures[i].other);
+        break;
+
+      case IDRIVEGESTURE_TURN:
+        turning |= button;
+        break;
+    }
+  }
+
+  for (unsigned char i = 0; i < 12; i++) {
+    pressedAt[i] = 0;
+  }
+}
@@ -0,0 +1,153 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEGESTURERECOGNIZER_H_
+#define IDRIVEGESTURERECOGNIZER_H_
+
+#include "IDriveDecoder.h"
+
+#include <stdint.h>
+
+#define IDRIVEGESTURE_DOUBLE 1  // button pressed twice within 'interval'
+#define IDRIVEGESTURE_CHORD  2  // button pressed while other is held, or the other way round
+#define IDRIVEGESTURE_TURN   3  // rotary turned while button is held, reports the delta
+
+/* one row of the gesture table, buttons are given by their press-eventId,
+ * e.g. { IDRIVEGESTURE_CHORD, IDRIVEDECODER_BACK, IDRIVEDECODER_OPTION, 1 } */
+struct IDriveGesture {
+  unsigned char type;    // IDRIVEGESTURE_*
+  unsigned char button;
+  unsigned char other;   // second button of a chord, 0 otherwise
+  unsigned char id;      // reported to the handler
+};
+
+/* recognizes the gestures of a table from the events decode reports.
+ *
+ * The held buttons are tracked as a mask of press-events and updated with a
+ * few bit operations per CAN-message, the table is only walked when a
+ * message presses a button of the table or turns the rotary while one is
+ * held. Memory is fixed: the table is not copied and stays with the caller.
+ * 'now' may come from any clock that counts up, e.g. millis().
+ */
+class IDriveGestureRecognizer {
+public:
+
+  IDriveGestureRecognizer(const IDriveGesture* gestures, const unsigned char count, const unsigned long interval);
+
+  /* feeds the events of one CAN-message and calls
+   * gestureEvent(const unsigned char id, const short value) for every gesture
+   * it completes, in the order of the table. value is the rotary delta of
+   * IDRIVEGESTURE_TURN, otherwise 0.
+   */
+  template<class GestureHandler>
+  inline void update(const IDriveEvents& events, const unsigned long now, GestureHandler& gestureEvent) {
+    const uint64_t pressed = track(events.mask);
+
+    if ((pressed & triggers) || (events.rotary && (held & turning))) {
+      match(pressed, events.rotary, now, gestureEvent);
+    }
+  }
+
+  /* takes the held buttons from the decoder state, e.g. after decode
+   * returned IDRIVEDECODER_RESET or the decoder was restored */
+  inline void sync(const IDriveDecoderState& state) {
+    held  = IDriveDecoderCore::held(state.switches);
+    armed = 0;
+  }
+
+  /* IDRIVEDECODER_EVENT(press-eventId) of the buttons held right now */
+  inline uint64_t buttons(void) const {
+    return held;
+  }
+
+private:
+
+  const IDriveGesture* const gestures;
+  const unsigned char        count;
+  const unsigned long        interval;
+
+  uint64_t      triggers;       // buttons whose press may complete a gesture
+  uint64_t      doubles;        // buttons of IDRIVEGESTURE_DOUBLE
+  uint64_t      turning;        // buttons of IDRIVEGESTURE_TURN
+  uint64_t      held;
+  uint64_t      armed;          // first press of a double press seen
+  unsigned long pressedAt[12];  // per button, for doubles only
+
+  /* updates held, returns the buttons pressed by this message */
+  inline uint64_t track(const uint64_t mask) {
+    const uint64_t pressed  = (mask | mask >> 1) & IDRIVEDECODER_PRESS_EVENTS;
+    const uint64_t released = mask >> 2 & IDRIVEDECODER_PRESS_EVENTS;
+
+    // only buttons that were released start a gesture, not long press after press
+    const uint64_t started = pressed & ~held;
+
+    held = (held | pressed) & ~released;
+    return started;
+  }
+
+  template<class GestureHandler>
+  void match(const uint64_t pressed, const short rotary, const unsigned long now, GestureHandler& gestureEvent) {
+    uint64_t doubled = 0;
+
+    for (unsigned char i = 0; i < count; i++) {
+      const IDriveGesture& gesture = gestures[i];
+      const uint64_t button = IDRIVEDECODER_EVENT(gesture.button);
+
+      switch (gesture.type) {
+        case IDRIVEGESTURE_DOUBLE:
+          if ((pressed & button) && (armed & button) && now - pressedAt[index(gesture.button)] < interval) {
+            doubled |= button;
+            gestureEvent(gesture.id, (short)0);
+          }
+          break;
+
+        case IDRIVEGESTURE_CHORD: {
+          const uint64_t other = IDRIVEDECODER_EVENT(gesture.other);
+          if ((pressed & (button | other)) && (held & button) && (held & other)) {
+            gestureEvent(gesture.id, (short)0);
+          }
+          break;
+        }
+
+        case IDRIVEGESTURE_TURN:
+          if (rotary && (held & button)) {
+            gestureEvent(gesture.id, rotary);
+          }
+          break;
+      }
+    }
+
+    // a completed double press does not count as the first of the next one
+    armed = (armed | (pressed & doubles)) & ~doubled;
+
+    uint64_t first = pressed & doubles & ~doubled;
+    for (unsigned char id = IDRIVEDECODER_CENTER; first; id += 3) {
+      if (first & IDRIVEDECODER_EVENT(id)) {
+        pressedAt[index(id)] = now;
+        first &= ~IDRIVEDECODER_EVENT(id);
+      }
+    }
+  }
+
+  static inline unsigned char index(const unsigned char eventId) {
+    return (eventId - 1) / 3;
+  }
+};
+
+#endif /* IDRIVEGESTURERECOGNIZER_H_ */
@@ -0,0 +1,139 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveInputTimer.h"
+
+IDriveInputTimer::IDriveInputTimer(const uint64_t repeating, const unsigned long delay, const unsigned long rate, const unsigned long timeout, const unsigned long resolution):repeating(repeating & IDRIVEDECODER_PRESS_EVENTS),delay(delay),rate(rate ? rate : 1),timeout(timeout),resolution(resolution ? resolution : 1),held(0),seen(0),position(0),scheduled(0) {
+
+  for (unsigned char i = 0; i < slots; i++) {
+    heads[i] = none;
+  }
+}
+
+void IDriveInputTimer::update(const IDriveEvents& events, const unsigned long now) {
+
+  seen = now;
+
+  if (!events.mask) {
+    return;
+  }
+
+  const uint64_t pressed  = (events.mask | events.mask >> 1) & IDRIVEDECODER_PRESS_EVENTS;
+  const uint64_t released = events.mask >> 2 & IDRIVEDECODER_PRESS_EVENTS;
+
+  // long press after press keeps the repeat running
+  uint64_t started = pressed & ~held & repeating;
+  uint64_t stopped = released & repeating;
+
+  held = (held | pressed) & ~released;
+
+  for (unsigned char timer = 0; started | stopped; timer++) {
+    const uint64_t bit = IDRIVEDECODER_EVENT(eventId(timer));
+
+    if (started & bit) {
+      schedule(timer, now + delay);
+    } else if (stopped & bit) {
+      cancel(timer);
+    }
+
+    started &= ~bit;
+    stopped &= ~bit;
+  }
+
+  if (timeout && held && !(scheduled & 1 << timeoutTimer)) {
+    schedule(timeoutTimer, now + timeout);
+  }
+}
+
+void IDriveInputTimer::schedule(const unsigned char timer, const unsigned long deadline) {
+
+  cancel(timer);
+
+  // timers already due go to the current slot, not one turn ahead
+  unsigned long time = deadline / resolution;
+  if ((long)(time - position) < 0) {
+    time = position;
+  }
+
+  const unsigned char slot = time & (slots - 1);
+
+  deadlines[timer] = deadline;
+  slotOf[timer]    = slot;
+  previous[timer]  = none;
+  next[timer]      = heads[slot];
+
+  if (heads[slot] != none) {
+    previous[heads[slot]] = timer;
+  }
+
+  heads[slot] = timer;
+  scheduled |= 1 << timer;
+}
+
+void IDriveInputTimer::cancel(const unsigned char timer) {
+
+  if (!(scheduled & 1 << timer)) {
+    return;
+  }
+
+  if (previous[timer] != none) {
+    next[previous[timer]] = next[timer];
+  } else {
+    heads[slotOf[timer]] = next[timer];
+  }
+
+  if (next[timer] != none) {
+    previous[next[timer]] = previous[timer];
+  }
+
+  scheduled &= ~(1 << timer);
+}
+
+unsigned char IDriveInputTimer::expire(const unsigned long now, unsigned char* fired) {
+
+  const unsigned long time = now / resolution;
+  unsigned long steps = time - position;
+
+  // a full turn visits every slot
+  if (steps >= slots) {
+    steps = slots - 1;
+  }
+
+  unsigned char count = 0;
+
+  if (scheduled) {
+    for (unsigned long i = 0; i <= steps; i++) {
+      unsigned char timer = heads[(position + i) & (slots - 1)];
+
+      while (timer != none) {
+        const unsigned char following = next[timer];
+
+        if ((long)(now - deadlines[timer]) >= 0) {
+          cancel(timer);
+          fired[count++] = timer;
+        }
+
+        timer = following;
+      }
+    }
+  }
+
+  position = time;
+  return count;
+}
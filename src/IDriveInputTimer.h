@@ -0,0 +1,142 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEINPUTTIMER_H_
+#define IDRIVEINPUTTIMER_H_
+
+#include "IDriveDecoder.h"
+
+#include <stdint.h>
+
+/* the time-dependent events the CAN-messages cannot tell: auto-repeat of held
+ * inputs and the release of everything held once the messages stop, e.g. on
+ * bus-off or when the controller resets.
+ *
+ * update takes the events of every decoded message, tick(now) reports the
+ * repeats and releases due by then. Timers live in a hashed wheel of 'slots'
+ * buckets 'resolution' ticks wide, so a tick costs the slots it advances
+ * plus the timers that expire, not one check per input. The frame timeout
+ * is only pushed back when it expires, update just notes the time.
+ * 'now' may come from any clock that counts up, e.g. millis().
+ */
+class IDriveInputTimer {
+public:
+
+  /* repeating: IDRIVEDECODER_EVENT(press-eventId) of the inputs to repeat,
+   * delay: ticks from the press to the first repeat,
+   * rate: ticks between repeats,
+   * timeout: ticks without CAN-messages until held inputs are released, 0
+   *   never releases them,
+   * resolution: ticks per slot of the wheel
+   */
+  IDriveInputTimer(const uint64_t repeating, const unsigned long delay, const unsigned long rate, const unsigned long timeout, const unsigned long resolution);
+
+  /* feeds the events of one CAN-message, idle ones included */
+  void update(const IDriveEvents& events, const unsigned long now);
+
+  /* calls switchEvent(const unsigned char eventId) with the press-eventId of
+   * every repeat due. Returns true when the CAN-messages timed out: the
+   * release-eventId of every held input was reported instead and the
+   * decoder has to forget them by release().
+   */
+  template<class SwitchHandler>
+  inline bool tick(const unsigned long now, SwitchHandler& switchEvent) {
+    unsigned char fired[timers];
+    const unsigned char count = expire(now, fired);
+
+    for (unsigned char i = 0; i < count; i++) {
+      if (fired[i] == timeoutTimer) {
+        if (now - seen < timeout) {
+          schedule(timeoutTimer, seen + timeout);
+        } else if (held) {
+          releaseAll(switchEvent);
+          return true;
+        }
+      }
+    }
+
+    for (unsigned char i = 0; i < count; i++) {
+      const unsigned char timer = fired[i];
+
+      if (timer != timeoutTimer) {
+        switchEvent((unsigned char)eventId(timer));
+
+        // keep the rate but do not catch up on missed repeats
+        const unsigned long next = deadlines[timer] + rate;
+        schedule(timer, (long)(next - now) > 0 ? next : now + rate);
+      }
+    }
+
+    return false;
+  }
+
+  /* IDRIVEDECODER_EVENT(press-eventId) of the inputs held right now */
+  inline uint64_t buttons(void) const {
+    return held;
+  }
+
+private:
+
+  static const unsigned char slots        = 16;  // power of 2
+  static const unsigned char timers       = 13;  // one per input, then the timeout
+  static const unsigned char timeoutTimer = 12;
+  static const unsigned char none         = 0xff;
+
+  const uint64_t      repeating;
+  const unsigned long delay;
+  const unsigned long rate;
+  const unsigned long timeout;
+  const unsigned long resolution;
+
+  uint64_t       held;
+  unsigned long  seen;       // time of the last CAN-message
+  unsigned long  position;   // slot time, now / resolution, of the last tick
+  unsigned short scheduled;  // bit per timer
+
+  unsigned char  heads[slots];
+  unsigned char  next[timers];
+  unsigned char  previous[timers];
+  unsigned char  slotOf[timers];
+  unsigned long  deadlines[timers];
+
+  static inline unsigned char eventId(const unsigned char timer) {
+    return IDRIVEDECODER_CENTER + 3 * timer;
+  }
+
+  void schedule(const unsigned char timer, const unsigned long deadline);
+  void cancel(const unsigned char timer);
+
+  /* unlinks the timers due at now from the slots passed since the last tick,
+   * returns their number */
+  unsigned char expire(const unsigned long now, unsigned char* fired);
+
+  template<class SwitchHandler>
+  void releaseAll(SwitchHandler& switchEvent) {
+    for (unsigned char timer = 0; timer < timeoutTimer; timer++) {
+      if (held & IDRIVEDECODER_EVENT(eventId(timer))) {
+        cancel(timer);
+        switchEvent((unsigned char)(eventId(timer) + 2));
+      }
+    }
+
+    held = 0;
+  }
+};
+
+#endif /* IDRIVEINPUTTIMER_H_ */
@@ -0,0 +1,158 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVELATENCYTRACE_H_
+#define IDRIVELATENCYTRACE_H_
+
+#include "IDriveDecoder.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* clocks for IDriveLatencyTrace: a static now() returning ticks that count
+ * up and may wrap */
+#if defined(ARDUINO)
+#include <Arduino.h>
+
+struct IDriveMicrosClock {
+  static inline uint32_t now(void) {
+    return micros();
+  }
+};
+#elif defined(__unix__)
+#include <time.h>
+
+struct IDriveMonotonicClock {
+  static inline uint32_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000000u + (uint32_t)ts.tv_nsec;
+  }
+};
+#endif
+
+/* counts of latencies in log2 buckets: bucket 0 holds 0, bucket b holds
+ * 2^(b-1) .. 2^b - 1 ticks */
+struct IDriveHistogram {
+  static const unsigned char buckets = 33;
+
+  uint32_t counts[buckets];
+
+  IDriveHistogram() {
+    clear();
+  }
+
+  inline void clear(void) {
+    for (unsigned char b = 0; b < buckets; b++) {
+      counts[b] = 0;
+    }
+  }
+
+  inline void add(const uint32_t ticks) {
+    counts[ticks ? sizeof(unsigned long) * 8 - __builtin_clzl(ticks) : 0]++;
+  }
+
+  uint32_t count(void) const {
+    uint32_t n = 0;
+    for (unsigned char b = 0; b < buckets; b++) {
+      n += counts[b];
+    }
+    return n;
+  }
+
+  /* upper bound in ticks of the bucket that holds the given per-mille of
+   * the latencies, e.g. 990 for p99 and 999 for p99.9. 0 when empty. */
+  uint32_t percentile(const unsigned short perMille) const {
+    const uint64_t rank = ((uint64_t)count() * perMille + 999) / 1000;
+    uint64_t       seen = 0;
+
+    for (unsigned char b = 0; b < buckets; b++) {
+      seen += counts[b];
+      if (seen && seen >= rank) {
+        return b ? (uint32_t)(((uint64_t)1 << b) - 1) : 0;
+      }
+    }
+    return 0;
+  }
+
+  /* the non-empty buckets as "bucket:count" separated by spaces, returns
+   * the length like snprintf */
+  int format(char* buffer, const size_t size) const {
+    int length = 0;
+
+    if (size) {
+      buffer[0] = 0;
+    }
+
+    for (unsigned char b = 0; b < buckets; b++) {
+      if (!counts[b]) {
+        continue;
+      }
+
+      const size_t used = (size_t)length < size ? length : size;
+      length += snprintf(buffer + used, size - used, "%s%u:%lu", length ? " " : "", b, (unsigned long)counts[b]);
+    }
+
+    return length;
+  }
+};
+
+/* tracing policy that takes a Clock tick on entry to decode, after the
+ * message is decoded and after each callback returns */
+template<class Clock>
+class IDriveLatencyTrace {
+public:
+
+  IDriveHistogram decode;    // entry to decode until the message is decoded
+  IDriveHistogram handler;   // each call of switchEvent or rotaryEvent
+  IDriveHistogram total;     // entry to decode until the last callback returns, messages with events only
+
+  inline void clear(void) {
+    decode.clear();
+    handler.clear();
+    total.clear();
+  }
+
+  inline void arrived(void) {
+    start = Clock::now();
+  }
+
+  inline void decoded(void) {
+    mark = Clock::now();
+    decode.add(mark - start);
+  }
+
+  inline void handled(void) {
+    const uint32_t now = Clock::now();
+    handler.add(now - mark);
+    mark = now;
+  }
+
+  inline void finished(const bool events) {
+    if (events) {
+      total.add(mark - start);
+    }
+  }
+
+private:
+  uint32_t start;
+  uint32_t mark;
+};
+
+#endif /* IDRIVELATENCYTRACE_H_ */
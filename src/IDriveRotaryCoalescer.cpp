@@ -0,0 +1,78 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveRotaryCoalescer.h"
+
+IDriveRotaryCoalescer::IDriveRotaryCoalescer(const unsigned char frames, const unsigned long window):total(0),velocity(0),frames(frames),window(window),open(false),count(0),sum(0),first(0),opened(0),moved(0) {
+}
+
+bool IDriveRotaryCoalescer::update(const IDriveEvents& events, const unsigned long now) {
+
+  if (!open && events.rotary) {
+    open   = true;
+    count  = 0;
+    sum    = 0;
+    first  = events.rotary;
+    opened = now;
+  }
+
+  if (!open) {
+    return false;
+  }
+
+  if (events.rotary) {
+    moved = now;
+  }
+
+  sum += events.rotary;
+  if (count < 0xff) {
+    count++;
+  }
+
+  if (events.mask || (frames && count >= frames)) {
+    return flush();
+  }
+
+  return poll(now);
+}
+
+bool IDriveRotaryCoalescer::poll(const unsigned long now) {
+  return open && window && now - opened >= window && flush();
+}
+
+bool IDriveRotaryCoalescer::flush(void) {
+
+  if (!open) {
+    return false;
+  }
+
+  open = false;
+
+  if (!sum) {
+    return false;
+  }
+
+  // the first delta was made before the window opened, only the later ones
+  // moved in the time measured
+  const unsigned long elapsed = moved - opened;
+
+  total    = sum;
+  velocity = elapsed ? (int32_t)((int64_t)(sum - first) * 1000 / (int64_t)elapsed) : 0;
+  return true;
+}
@@ -0,0 +1,74 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVEROTARYCOALESCER_H_
+#define IDRIVEROTARYCOALESCER_H_
+
+#include "IDriveDecoder.h"
+
+#include <stdint.h>
+
+/* adds up the rotary deltas of several CAN-messages and reports them as one,
+ * e.g. to redraw a UI once per window instead of once per message.
+ *
+ * A window opens with the first message that moves the rotary and is
+ * reported when
+ *   - it spans 'frames' messages (0: no limit),
+ *   - 'window' ticks have passed since it opened (0: no limit, checked by
+ *     update and poll),
+ *   - a message carries a switch event, so the rotary is reported before
+ *     that event, or
+ *   - flush is called.
+ * 'now' may come from any clock that counts up, e.g. millis(). A window
+ * whose deltas add up to 0 is dropped.
+ */
+class IDriveRotaryCoalescer {
+public:
+
+  int32_t total;     // sum of the deltas of the reported window
+  int32_t velocity;  // steps per 1000 ticks (steps per second with millis())
+                     // between the first and the last message of the window
+                     // that moved the rotary, 0 if there was only one
+
+  IDriveRotaryCoalescer(const unsigned char frames, const unsigned long window);
+
+  /* feeds the events of one CAN-message, returns true when total and
+   * velocity hold a window to report */
+  bool update(const IDriveEvents& events, const unsigned long now);
+
+  /* reports the open window once 'window' ticks have passed, for when no
+   * CAN-messages arrive */
+  bool poll(const unsigned long now);
+
+  /* reports the open window right away */
+  bool flush(void);
+
+private:
+  const unsigned char frames;
+  const unsigned long window;
+
+  bool          open;
+  unsigned char count;   // messages of the open window
+  int32_t       sum;
+  short         first;   // delta of the first message of the window
+  unsigned long opened;  // time of the first message of the window
+  unsigned long moved;   // time of the last message that moved the rotary
+};
+
+#endif /* IDRIVEROTARYCOALESCER_H_ */
@@ -0,0 +1,90 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IDriveTouchDecoder.h"
+
+#include <string.h>
+
+IDriveTouchDecoderCore::IDriveTouchDecoderCore() {
+  reset();
+}
+
+bool IDriveTouchDecoderCore::decode(const unsigned char* data, IDriveTouchEvent& event) {
+
+  // the touchpad repeats its message while nothing changes
+  uint64_t frame;
+  memcpy(&frame, data, sizeof(frame));
+  reinterpret_cast<unsigned char*>(&frame)[0] = 0;
+
+  if (frame == lastFrame) {
+    return false;
+  }
+
+  lastFrame = frame;
+
+  unsigned char count;
+
+  switch (data[4]) {
+    case oneFinger:    count = 1; break;
+    case twoFingers:   count = 2; break;
+    case threeFingers: count = 3; break;
+    default:           count = 0; break;
+  }
+
+  if (!count) {
+    if (!fingers) {
+      return false;
+    }
+
+    fingers = 0;
+
+    event.type    = IDRIVETOUCH_RELEASE;
+    event.fingers = 0;
+    event.x       = x;
+    event.y       = y;
+    event.dx      = 0;
+    event.dy      = 0;
+    return true;
+  }
+
+  const unsigned short newX = (data[2] & 0x0f) << 8 | data[1];
+  const unsigned short newY = data[3] << 4 | data[2] >> 4;
+
+  if (!fingers) {
+    event.type = IDRIVETOUCH_PRESS;
+    event.dx   = 0;
+    event.dy   = 0;
+  } else if (count == fingers && newX == x && newY == y) {
+    // only the second finger or unused bits changed
+    return false;
+  } else {
+    event.type = IDRIVETOUCH_MOVE;
+    event.dx   = newX - x;
+    event.dy   = newY - y;
+  }
+
+  fingers = count;
+  x       = newX;
+  y       = newY;
+
+  event.fingers = count;
+  event.x       = newX;
+  event.y       = newY;
+  return true;
+}
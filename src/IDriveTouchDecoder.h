@@ -0,0 +1,118 @@
+/*
+ *   IDriveDecoder - Arduino library to decode CAN-Bus message of IDrive.
+ *
+ *   Copyright (C) 2020 Norbert Truchsess norbert.truchsess@t-online.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *                                            
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDRIVETOUCHDECODER_H_
+#define IDRIVETOUCHDECODER_H_
+
+#include <stdint.h>
+
+/* CAN-message 0x0BF of the touchpad. Layout as observed on the controller,
+ * byte positions within the 8-byte message:
+ *
+ * 0   Counter (1 byte), not evaluated
+ *
+ * 1,2 X of the first finger: byte 1 low 8 bits, byte 2 low nibble high 4 bits
+ * 2,3 Y of the first finger: byte 2 high nibble low 4 bits, byte 3 high 8 bits
+ *
+ * 4   Fingers:
+ *
+ *     none:  0x11
+ *     one:   0x10
+ *     two:   0x00
+ *     three: 0x1f
+ *
+ * 5-7 X/Y of the second finger, packed like bytes 1-3
+ */
+
+#define IDRIVETOUCH_PRESS   1   // first finger down
+#define IDRIVETOUCH_MOVE    2   // position or number of fingers changed
+#define IDRIVETOUCH_RELEASE 3   // last finger up
+
+#define IDRIVETOUCH_ID 0x0BF
+
+struct IDriveTouchEvent {
+  unsigned char  type;     // IDRIVETOUCH_*
+  unsigned char  fingers;  // 0 on release
+  unsigned short x;        // first finger, 12 bits, last position on release
+  unsigned short y;
+  short          dx;       // change since the previous event, 0 on press
+  short          dy;
+};
+
+/* touch state and the callback-free decode */
+class IDriveTouchDecoderCore {
+public:
+
+  IDriveTouchDecoderCore();
+
+  /* returns true and fills event when the message changed the touch,
+   * repeated messages and repeated positions return false */
+  bool decode(const unsigned char* data, IDriveTouchEvent& event);
+
+  inline void reset(void) {
+    // byte 0 is cleared in every message, so the first one always differs
+    lastFrame = 0;
+    reinterpret_cast<unsigned char*>(&lastFrame)[0] = 0x01;
+
+    fingers   = 0;
+    x         = 0;
+    y         = 0;
+  }
+
+private:
+
+  static const unsigned char noFinger     = 0x11;
+  static const unsigned char oneFinger    = 0x10;
+  static const unsigned char twoFingers   = 0x00;
+  static const unsigned char threeFingers = 0x1f;
+
+  uint64_t       lastFrame;  // bytes 1-7 of the last message, byte 0 is 1 before the first
+  unsigned char  fingers;
+  unsigned short x;
+  unsigned short y;
+};
+
+/* calls touchEvent(const IDriveTouchEvent&) for every change of the touch */
+template<class TouchHandler>
+class BasicIDriveTouchDecoder : public IDriveTouchDecoderCore {
+public:
+
+  TouchHandler touchEvent;
+
+  BasicIDriveTouchDecoder(TouchHandler touchEvent):touchEvent(touchEvent) {
+  }
+
+  using IDriveTouchDecoderCore::decode;
+
+  inline void decode(const unsigned char* data) {
+    IDriveTouchEvent event;
+    if (IDriveTouchDecoderCore::decode(data, event)) {
+      touchEvent(event);
+    }
+  }
+};
+
+typedef BasicIDriveTouchDecoder<const void (&)(const IDriveTouchEvent&)> IDriveTouchDecoder;
+
+template<class TouchHandler>
+inline BasicIDriveTouchDecoder<TouchHandler> makeIDriveTouchDecoder(TouchHandler touchEvent) {
+  return BasicIDriveTouchDecoder<TouchHandler>(touchEvent);
+}
+
+#endif /* IDRIVETOUCHDECODER_H_ */